@@ -0,0 +1,494 @@
+#include "scene.h"
+#include "scene_importer.h"
+#include "camera.h"
+#include "camera_path.h"
+#include "renderer.h"
+#include "cpu_profiler.h"
+#include "golden.h"
+#include <core/path.h>
+#include <rhi/ez_vulkan.h>
+#include <rhi/rhi_shader_mgr.h>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+struct BenchmarkOptions
+{
+    std::vector<std::string> scenes;
+    // Every scene is cooked and measured once per cluster size
+    std::vector<uint32_t> cluster_sizes;
+    uint32_t width = 1920;
+    uint32_t height = 1080;
+    uint32_t warmup_frame_count = 16;
+    uint32_t frame_count = 256;
+    std::string camera_path;
+    std::string output;
+    std::string trace_path;
+    bool cpu_filtering = false;
+    bool temporal_reuse = true;
+    bool pipelined_filtering = false;
+    bool shadows = false;
+    // Random point and spot lights added to every scene
+    uint32_t light_count = 0;
+    GoldenOptions golden;
+};
+
+struct SceneResult
+{
+    std::string scene;
+    uint32_t cluster_size = CLUSTER_SIZE;
+    // CPU recording and submit of every measured frame
+    std::vector<double> frame_times;
+    // GPU execution from the timestamps of the measured frames that resolved in time
+    std::vector<double> gpu_frame_times;
+    std::map<std::string, std::vector<double>> pass_cpu_times;
+    std::map<std::string, std::vector<double>> pass_gpu_times;
+    uint64_t cluster_count = 0;
+    uint64_t visible_cluster_count = 0;
+    uint64_t tested_cluster_count = 0;
+    uint64_t triangle_count = 0;
+    uint64_t visible_triangle_count = 0;
+    uint64_t barrier_count = 0;
+    uint64_t reused_frame_count = 0;
+    // Frames that lost shadow cascades to the draw limit
+    uint64_t dropped_view_frame_count = 0;
+    // Frames that left visible clusters of the camera out to the draw limit
+    uint64_t dropped_cluster_frame_count = 0;
+    uint64_t gpu_memory_size = 0;
+    // Part of gpu_memory_size, the render graph textures after aliasing
+    uint64_t transient_memory_size = 0;
+    // GPU side counters, accumulated over the frames whose readback arrived while measuring
+    uint64_t gpu_counter_frame_count = 0;
+    uint64_t gpu_batch_count = 0;
+    uint64_t gpu_input_triangle_count = 0;
+    uint64_t gpu_output_triangle_count = 0;
+    uint64_t gpu_draw_count = 0;
+    std::map<std::string, std::vector<GpuPipelineStatistics>> pipeline_statistics;
+    bool has_golden = false;
+    GoldenResult golden;
+};
+
+static std::vector<std::string> split(const std::string& value, char delimiter)
+{
+    std::vector<std::string> parts;
+    std::stringstream stream(value);
+    std::string part;
+    while (std::getline(stream, part, delimiter))
+    {
+        if (!part.empty())
+            parts.push_back(part);
+    }
+    return parts;
+}
+
+static BenchmarkOptions parse_options(int argc, char** argv)
+{
+    BenchmarkOptions options;
+    for (int i = 1; i < argc; ++i)
+    {
+        bool has_value = i + 1 < argc;
+        if (strcmp(argv[i], "--scenes") == 0 && has_value)
+            options.scenes = split(argv[++i], ',');
+        else if (strcmp(argv[i], "--cluster-sizes") == 0 && has_value)
+        {
+            for (auto& cluster_size : split(argv[++i], ','))
+            {
+                options.cluster_sizes.push_back((uint32_t)atoi(cluster_size.c_str()));
+            }
+        }
+        else if (strcmp(argv[i], "--width") == 0 && has_value)
+            options.width = (uint32_t)atoi(argv[++i]);
+        else if (strcmp(argv[i], "--height") == 0 && has_value)
+            options.height = (uint32_t)atoi(argv[++i]);
+        else if (strcmp(argv[i], "--warmup") == 0 && has_value)
+            options.warmup_frame_count = (uint32_t)atoi(argv[++i]);
+        else if (strcmp(argv[i], "--frames") == 0 && has_value)
+            options.frame_count = (uint32_t)atoi(argv[++i]);
+        else if (strcmp(argv[i], "--camera-path") == 0 && has_value)
+            options.camera_path = argv[++i];
+        else if (strcmp(argv[i], "--output") == 0 && has_value)
+            options.output = argv[++i];
+        else if (strcmp(argv[i], "--cpu-filtering") == 0)
+            options.cpu_filtering = true;
+        else if (strcmp(argv[i], "--no-temporal-reuse") == 0)
+            options.temporal_reuse = false;
+        else if (strcmp(argv[i], "--pipelined-filtering") == 0)
+            options.pipelined_filtering = true;
+        else if (strcmp(argv[i], "--shadows") == 0)
+            options.shadows = true;
+        else if (strcmp(argv[i], "--lights") == 0 && has_value)
+            options.light_count = (uint32_t)atoi(argv[++i]);
+        else if (strcmp(argv[i], "--golden") == 0 && has_value)
+            options.golden.directory = argv[++i];
+        else if (strcmp(argv[i], "--update-golden") == 0)
+            options.golden.update = true;
+        else if (strcmp(argv[i], "--golden-cpu") == 0)
+            options.golden.cpu = true;
+        else if (strcmp(argv[i], "--golden-views") == 0 && has_value)
+            options.golden.view_count = (uint32_t)atoi(argv[++i]);
+        else if (strcmp(argv[i], "--golden-tolerance") == 0 && has_value)
+            options.golden.color_tolerance = (uint32_t)atoi(argv[++i]);
+        else if (strcmp(argv[i], "--trace") == 0 && has_value)
+            options.trace_path = argv[++i];
+    }
+    if (options.scenes.empty())
+        options.scenes.push_back("scene://dragon/dragon.gltf");
+    if (options.cluster_sizes.empty())
+        options.cluster_sizes.push_back(CLUSTER_SIZE);
+    return options;
+}
+
+static uint64_t get_peak_rss()
+{
+#if defined(__linux__)
+    std::ifstream file("/proc/self/status");
+    std::string line;
+    while (std::getline(file, line))
+    {
+        if (line.compare(0, 6, "VmHWM:") == 0)
+            return std::stoull(line.substr(6)) * 1024;
+    }
+#endif
+    return 0;
+}
+
+static void write_distribution(std::ostream& out, std::vector<double> values)
+{
+    if (values.empty())
+    {
+        out << "{}";
+        return;
+    }
+
+    std::sort(values.begin(), values.end());
+    double sum = 0.0;
+    for (auto value : values)
+    {
+        sum += value;
+    }
+    auto percentile = [&values](double p) {
+        size_t index = std::min(values.size() - 1, (size_t)(p * (double)(values.size() - 1) + 0.5));
+        return values[index];
+    };
+    out << "{\"mean\": " << sum / (double)values.size()
+        << ", \"p50\": " << percentile(0.50)
+        << ", \"p95\": " << percentile(0.95)
+        << ", \"p99\": " << percentile(0.99)
+        << ", \"max\": " << values.back() << "}";
+}
+
+static double get_mean(const std::vector<double>& values)
+{
+    double sum = 0.0;
+    for (auto value : values)
+    {
+        sum += value;
+    }
+    return values.empty() ? 0.0 : sum / (double)values.size();
+}
+
+// Cluster size with the lowest mean GPU frame time for every scene measured with more than one size
+static void write_cluster_size_winners(std::ostream& out, const std::vector<SceneResult>& results)
+{
+    std::map<std::string, const SceneResult*> winners;
+    std::map<std::string, uint32_t> size_counts;
+    for (auto& result : results)
+    {
+        if (result.gpu_frame_times.empty())
+            continue;
+        size_counts[result.scene]++;
+        auto iter = winners.find(result.scene);
+        if (iter == winners.end() || get_mean(result.gpu_frame_times) < get_mean(iter->second->gpu_frame_times))
+            winners[result.scene] = &result;
+    }
+
+    out << "{";
+    size_t scene_index = 0;
+    for (auto& winner : winners)
+    {
+        if (size_counts[winner.first] < 2)
+            continue;
+        out << (scene_index++ > 0 ? ", " : "") << "\"" << winner.first << "\": {"
+            << "\"cluster_size\": " << winner.second->cluster_size
+            << ", \"gpu_frame_time_ms\": " << get_mean(winner.second->gpu_frame_times) << "}";
+    }
+    out << "}";
+}
+
+static double get_ratio(uint64_t part, uint64_t total)
+{
+    return total > 0 ? (double)part / (double)total : 0.0;
+}
+
+static void write_pass_times(std::ostream& out, const std::map<std::string, std::vector<double>>& pass_times)
+{
+    out << "{";
+    size_t pass_index = 0;
+    for (auto& times : pass_times)
+    {
+        out << (pass_index++ > 0 ? ", " : "") << "\"" << times.first << "\": ";
+        write_distribution(out, times.second);
+    }
+    out << "}";
+}
+
+static void write_pipeline_statistics(std::ostream& out, const std::map<std::string, std::vector<GpuPipelineStatistics>>& pass_statistics)
+{
+    out << "{";
+    size_t pass_index = 0;
+    for (auto& statistics_list : pass_statistics)
+    {
+        GpuPipelineStatistics sum{};
+        for (auto& statistics : statistics_list.second)
+        {
+            sum.input_assembly_primitives += statistics.input_assembly_primitives;
+            sum.vertex_shader_invocations += statistics.vertex_shader_invocations;
+            sum.clipping_invocations += statistics.clipping_invocations;
+            sum.clipping_primitives += statistics.clipping_primitives;
+            sum.fragment_shader_invocations += statistics.fragment_shader_invocations;
+        }
+        double count = (double)std::max((size_t)1, statistics_list.second.size());
+        out << (pass_index++ > 0 ? ", " : "") << "\"" << statistics_list.first << "\": {"
+            << "\"input_assembly_primitives\": " << (double)sum.input_assembly_primitives / count
+            << ", \"vertex_shader_invocations\": " << (double)sum.vertex_shader_invocations / count
+            << ", \"clipping_invocations\": " << (double)sum.clipping_invocations / count
+            << ", \"clipping_primitives\": " << (double)sum.clipping_primitives / count
+            << ", \"fragment_shader_invocations\": " << (double)sum.fragment_shader_invocations / count << "}";
+    }
+    out << "}";
+}
+
+static void write_results(std::ostream& out, const BenchmarkOptions& options, const std::vector<SceneResult>& results)
+{
+    out << "{\n";
+    out << "  \"width\": " << options.width << ",\n";
+    out << "  \"height\": " << options.height << ",\n";
+    out << "  \"frame_count\": " << options.frame_count << ",\n";
+    out << "  \"pipelined_filtering\": " << (options.pipelined_filtering ? "true" : "false") << ",\n";
+    out << "  \"shadows\": " << (options.shadows ? "true" : "false") << ",\n";
+    out << "  \"light_count\": " << options.light_count << ",\n";
+    out << "  \"peak_rss_bytes\": " << get_peak_rss() << ",\n";
+    out << "  \"scenes\": [\n";
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        const SceneResult& result = results[i];
+        out << "    {\n";
+        out << "      \"scene\": \"" << result.scene << "\",\n";
+        out << "      \"cluster_size\": " << result.cluster_size << ",\n";
+        out << "      \"frame_time_ms\": ";
+        write_distribution(out, result.frame_times);
+        out << ",\n";
+        out << "      \"gpu_frame_time_ms\": ";
+        write_distribution(out, result.gpu_frame_times);
+        out << ",\n";
+        out << "      \"pass_cpu_time_ms\": ";
+        write_pass_times(out, result.pass_cpu_times);
+        out << ",\n";
+        out << "      \"pass_gpu_time_ms\": ";
+        write_pass_times(out, result.pass_gpu_times);
+        out << ",\n";
+        out << "      \"cluster_cull_rate\": " << 1.0 - get_ratio(result.visible_cluster_count, result.cluster_count) << ",\n";
+        out << "      \"cluster_test_rate\": " << get_ratio(result.tested_cluster_count, result.cluster_count) << ",\n";
+        out << "      \"triangle_cull_rate\": " << 1.0 - get_ratio(result.visible_triangle_count, result.triangle_count) << ",\n";
+        double gpu_counter_frame_count = (double)std::max((uint64_t)1, result.gpu_counter_frame_count);
+        out << "      \"gpu_counters_per_frame\": {"
+            << "\"batches\": " << (double)result.gpu_batch_count / gpu_counter_frame_count
+            << ", \"input_triangles\": " << (double)result.gpu_input_triangle_count / gpu_counter_frame_count
+            << ", \"output_triangles\": " << (double)result.gpu_output_triangle_count / gpu_counter_frame_count
+            << ", \"draws\": " << (double)result.gpu_draw_count / gpu_counter_frame_count << "},\n";
+        out << "      \"pipeline_statistics_per_frame\": ";
+        write_pipeline_statistics(out, result.pipeline_statistics);
+        out << ",\n";
+        out << "      \"reused_frames\": " << result.reused_frame_count << ",\n";
+        out << "      \"dropped_view_frames\": " << result.dropped_view_frame_count << ",\n";
+        out << "      \"dropped_cluster_frames\": " << result.dropped_cluster_frame_count << ",\n";
+        out << "      \"barriers_per_frame\": " << (double)result.barrier_count / (double)std::max(1u, options.frame_count) << ",\n";
+        if (result.has_golden)
+        {
+            out << "      \"golden\": ";
+            write_golden_result(out, result.golden);
+            out << ",\n";
+        }
+        out << "      \"transient_memory_bytes\": " << result.transient_memory_size << ",\n";
+        out << "      \"gpu_memory_bytes\": " << result.gpu_memory_size << "\n";
+        out << "    }" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ],\n";
+    out << "  \"cluster_size_winners\": ";
+    write_cluster_size_winners(out, results);
+    out << "\n";
+    out << "}\n";
+}
+
+// "scene://dragon/dragon.gltf" -> "dragon"
+static std::string get_scene_name(const std::string& scene_path)
+{
+    size_t begin = scene_path.find_last_of("/\\");
+    begin = begin == std::string::npos ? 0 : begin + 1;
+    size_t end = scene_path.find_last_of('.');
+    end = end == std::string::npos || end < begin ? scene_path.size() : end;
+    return scene_path.substr(begin, end - begin);
+}
+
+static SceneResult run_scene(const BenchmarkOptions& options, const std::string& scene_path, uint32_t cluster_size)
+{
+    SceneResult result;
+    result.scene = scene_path;
+    result.cluster_size = cluster_size;
+
+    Scene* scene = load_scene(scene_path, cluster_size);
+    if (!scene)
+    {
+        std::cerr << "failed to load " << scene_path << " with cluster size " << cluster_size << std::endl;
+        return result;
+    }
+    add_random_lights(scene, options.light_count);
+
+    Camera* camera = new Camera();
+    camera->set_aspect((float)options.width / (float)options.height);
+
+    CameraPath camera_path;
+    if (options.camera_path.empty() || !camera_path.load(options.camera_path))
+        camera_path = CameraPath::create_orbit(scene->bounds, 64);
+
+    Renderer* renderer = new Renderer();
+    renderer->set_scene(scene);
+    renderer->set_camera(camera);
+    renderer->set_cpu_triangle_filtering(options.cpu_filtering);
+    renderer->set_temporal_reuse(options.temporal_reuse);
+    renderer->set_pipelined_filtering(options.pipelined_filtering);
+    renderer->set_shadows(options.shadows);
+    EzTexture target = Renderer::create_offscreen_target(options.width, options.height);
+
+    // Correctness first, every measured run is checked against the golden images
+    if (!options.golden.directory.empty())
+    {
+        result.has_golden = true;
+        result.golden = run_golden(options.golden, get_scene_name(scene_path), scene, camera, camera_path, renderer, options.width, options.height);
+    }
+
+    // The golden renders went through the same renderer, GPU results are matched against the
+    // renderer frame number measuring started at rather than the loop index
+    uint64_t measure_frame_number = 0;
+    uint32_t total_frame_count = options.warmup_frame_count + options.frame_count;
+    for (uint32_t i = 0; i < total_frame_count; ++i)
+    {
+        if (i == options.warmup_frame_count)
+            measure_frame_number = renderer->get_frame_number();
+
+        // Warmup replays the start of the path, measured frames always cover the whole path
+        uint32_t path_frame = i < options.warmup_frame_count ? 0 : i - options.warmup_frame_count;
+        camera_path.apply(camera, (float)path_frame / (float)std::max(1u, options.frame_count - 1));
+
+        auto start_time = std::chrono::high_resolution_clock::now();
+        {
+            PROFILE_SCOPE("frame");
+            renderer->render(target);
+            ez_submit();
+        }
+        auto end_time = std::chrono::high_resolution_clock::now();
+
+        if (i < options.warmup_frame_count)
+            continue;
+
+        const FrameStats& frame_stats = renderer->get_frame_stats();
+        result.frame_times.push_back(std::chrono::duration<double, std::milli>(end_time - start_time).count());
+        for (auto& pass_timing : frame_stats.pass_timings)
+        {
+            result.pass_cpu_times[pass_timing.name].push_back(pass_timing.cpu_time);
+        }
+        // Timestamps resolve FRAMES_IN_FLIGHT frames late, the last few measured frames are not included
+        if (frame_stats.gpu_timings_frame_number >= measure_frame_number)
+        {
+            for (auto& pass_timing : frame_stats.gpu_pass_timings)
+            {
+                result.pass_gpu_times[pass_timing.name].push_back(pass_timing.gpu_time);
+            }
+            for (auto& statistics : frame_stats.pipeline_statistics)
+            {
+                result.pipeline_statistics[statistics.name].push_back(statistics);
+            }
+            if (frame_stats.gpu_frame_time > 0.0)
+                result.gpu_frame_times.push_back(frame_stats.gpu_frame_time);
+        }
+        result.cluster_count += frame_stats.cluster_count;
+        result.visible_cluster_count += frame_stats.visible_cluster_count;
+        result.tested_cluster_count += frame_stats.tested_cluster_count;
+        result.triangle_count += frame_stats.triangle_count;
+        result.visible_triangle_count += frame_stats.visible_triangle_count;
+        result.barrier_count += frame_stats.barrier_count;
+        result.reused_frame_count += frame_stats.reused_visibility_buffer ? 1 : 0;
+        result.dropped_view_frame_count += frame_stats.dropped_view_count > 0 ? 1 : 0;
+        result.dropped_cluster_frame_count += frame_stats.dropped_cluster_count > 0 ? 1 : 0;
+        if (frame_stats.gpu_counters_frame_number >= measure_frame_number)
+        {
+            result.gpu_counter_frame_count++;
+            result.gpu_batch_count += frame_stats.gpu_batch_count;
+            result.gpu_input_triangle_count += frame_stats.gpu_input_triangle_count;
+            result.gpu_output_triangle_count += frame_stats.gpu_output_triangle_count;
+            result.gpu_draw_count += frame_stats.gpu_draw_count;
+        }
+    }
+    ez_flush();
+
+    result.gpu_memory_size = renderer->get_gpu_memory_size();
+    result.transient_memory_size = renderer->get_transient_memory_size();
+
+    ez_destroy_texture(target);
+    delete renderer;
+    delete camera;
+    delete scene;
+    return result;
+}
+
+int main(int argc, char** argv)
+{
+    BenchmarkOptions options = parse_options(argc, argv);
+    set_cpu_profiling_enabled(!options.trace_path.empty());
+
+    Path::register_protocol("content", std::string(PROJECT_DIR) + "/content/");
+    Path::register_protocol("scene", std::string(PROJECT_DIR) + "/content/scene/");
+    Path::register_protocol("shader", std::string(PROJECT_DIR) + "/content/shader/");
+
+    ez_init();
+    rhi_shader_mgr_init();
+
+    std::vector<SceneResult> results;
+    for (auto& scene_path : options.scenes)
+    {
+        for (auto cluster_size : options.cluster_sizes)
+        {
+            results.push_back(run_scene(options, scene_path, cluster_size));
+        }
+    }
+
+    if (options.output.empty())
+    {
+        write_results(std::cout, options, results);
+    }
+    else
+    {
+        std::ofstream file(options.output);
+        write_results(file, options, results);
+    }
+
+    if (!options.trace_path.empty())
+        write_cpu_trace(options.trace_path);
+
+    bool golden_passed = true;
+    for (auto& result : results)
+    {
+        golden_passed = golden_passed && (!result.has_golden || result.golden.passed);
+    }
+
+    rhi_shader_mgr_terminate();
+    ez_flush();
+    ez_terminate();
+    return golden_passed ? 0 : 1;
+}
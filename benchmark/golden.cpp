@@ -0,0 +1,236 @@
+#include "golden.h"
+#include "camera.h"
+#include "camera_path.h"
+#include "cpu_rasterizer.h"
+#include "cpu_triangle_filtering.h"
+#include "readback.h"
+#include "renderer.h"
+#include "scene.h"
+#include <rhi/ez_vulkan.h>
+#include <array>
+#include <map>
+
+static EzTexture create_capture_target(uint32_t width, uint32_t height)
+{
+    EzTextureDesc desc{};
+    desc.width = width;
+    desc.height = height;
+    desc.format = VK_FORMAT_B8G8R8A8_UNORM;
+    desc.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    EzTexture target = VK_NULL_HANDLE;
+    ez_create_texture(desc, target);
+    ez_create_texture_view(target, VK_IMAGE_VIEW_TYPE_2D, VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1);
+    return target;
+}
+
+// Ids that could not be traced back to a triangle of the scene
+#define UNRESOLVED_ID (CPU_RASTER_CLEAR_ID - 1)
+
+static void write_id(uint8_t* pixel, uint32_t id)
+{
+    pixel[0] = (uint8_t)((id >> 16) & 0xFF);
+    pixel[1] = (uint8_t)((id >> 8) & 0xFF);
+    pixel[2] = (uint8_t)(id & 0xFF);
+    pixel[3] = (uint8_t)((id >> 24) & 0xFF);
+}
+
+// Mesh and source triangle index have to stay below the two reserved ids
+static bool fits_id_encoding(Scene* scene)
+{
+    if (scene->mesh_constants.size() >= UNRESOLVED_ID)
+        return false;
+    for (auto& mesh_constants : scene->mesh_constants)
+    {
+        if (mesh_constants.face_count >= UNRESOLVED_ID)
+            return false;
+    }
+    return true;
+}
+
+// Resolves the draw and primitive of every id to the mesh and the triangle of the mesh it was filtered
+// from, written as two separate id images. Neither the compaction order of the GPU atomics nor the
+// culling changes those.
+static void resolve_ids(Scene* scene, const std::vector<uint32_t>& indices, const std::vector<DrawCommand>& draw_commands,
+                        const std::vector<uint32_t>& draw_mesh_indices, const std::vector<uint8_t>& vb_pixels,
+                        std::vector<uint8_t>& mesh_pixels, std::vector<uint8_t>& triangle_pixels)
+{
+    mesh_pixels.resize(vb_pixels.size());
+    triangle_pixels.resize(vb_pixels.size());
+
+    // Source triangle of every index triple, built for the meshes that show up
+    std::vector<std::map<std::array<uint32_t, 3>, uint32_t>> mesh_triangles(scene->mesh_constants.size());
+    for (size_t i = 0; i < vb_pixels.size() / 4; ++i)
+    {
+        const uint8_t* pixel = &vb_pixels[i * 4];
+        uint32_t id = (uint32_t)pixel[2] | ((uint32_t)pixel[1] << 8) | ((uint32_t)pixel[0] << 16) | ((uint32_t)pixel[3] << 24);
+        uint32_t resolved_mesh = CPU_RASTER_CLEAR_ID;
+        uint32_t resolved_triangle = CPU_RASTER_CLEAR_ID;
+        if (id != CPU_RASTER_CLEAR_ID)
+        {
+            resolved_mesh = UNRESOLVED_ID;
+            resolved_triangle = UNRESOLVED_ID;
+            uint32_t draw_id = (id >> 23) & 0xFF;
+            uint32_t primitive_id = id & 0x007FFFFF;
+            if (draw_id < draw_commands.size() && draw_id < draw_mesh_indices.size() && draw_mesh_indices[draw_id] < mesh_triangles.size())
+            {
+                uint32_t mesh_index = draw_mesh_indices[draw_id];
+                const MeshConstants& mesh_constants = scene->mesh_constants[mesh_index];
+                std::map<std::array<uint32_t, 3>, uint32_t>& triangles = mesh_triangles[mesh_index];
+                if (triangles.empty())
+                {
+                    for (uint32_t face = 0; face < mesh_constants.face_count; ++face)
+                    {
+                        const uint32_t* face_indices = &scene->indices[mesh_constants.index_offset + face * 3];
+                        triangles.insert({{face_indices[0], face_indices[1], face_indices[2]}, face});
+                    }
+                }
+
+                uint32_t first_index = draw_commands[draw_id].first_index + primitive_id * 3;
+                if (first_index + 2 < indices.size())
+                {
+                    auto it = triangles.find({indices[first_index], indices[first_index + 1], indices[first_index + 2]});
+                    if (it != triangles.end())
+                    {
+                        resolved_mesh = mesh_index;
+                        resolved_triangle = it->second;
+                    }
+                }
+            }
+        }
+
+        write_id(&mesh_pixels[i * 4], resolved_mesh);
+        write_id(&triangle_pixels[i * 4], resolved_triangle);
+    }
+}
+
+static GoldenImageResult check_image(const GoldenOptions& options, const std::string& name, bool ids,
+                                     const std::vector<uint8_t>& pixels, uint32_t width, uint32_t height)
+{
+    GoldenImageResult result;
+    result.name = name;
+
+    // IDs need the alpha channel
+    std::string file_path = options.directory + "/" + name + (ids ? ".pam" : ".ppm");
+    if (options.update)
+    {
+        result.passed = ids ? write_pam(file_path, width, height, pixels) : write_ppm(file_path, width, height, pixels);
+        return result;
+    }
+
+    uint32_t golden_width = 0;
+    uint32_t golden_height = 0;
+    std::vector<uint8_t> golden_pixels;
+    bool loaded = ids ? read_pam(file_path, golden_width, golden_height, golden_pixels) : read_ppm(file_path, golden_width, golden_height, golden_pixels);
+    if (!loaded || golden_width != width || golden_height != height)
+    {
+        result.missing = true;
+        return result;
+    }
+
+    // PPM has no alpha, shaded color is compared without it
+    std::vector<uint8_t> actual_pixels = pixels;
+    if (!ids)
+    {
+        for (uint32_t i = 0; i < width * height; ++i)
+        {
+            actual_pixels[i * 4 + 3] = 255;
+        }
+    }
+
+    std::vector<uint8_t> diff_pixels;
+    uint32_t tolerance = ids ? 0 : options.color_tolerance;
+    result.compare = compare_images(golden_pixels, actual_pixels, width, height, tolerance, &diff_pixels);
+    double max_mismatch_ratio = ids ? options.max_id_mismatch_ratio : options.max_color_mismatch_ratio;
+    result.passed = (double)result.compare.mismatch_count <= max_mismatch_ratio * (double)result.compare.pixel_count;
+    if (result.compare.mismatch_count > 0)
+        write_ppm(options.directory + "/" + name + "_diff.ppm", width, height, diff_pixels);
+    return result;
+}
+
+GoldenResult run_golden(const GoldenOptions& options, const std::string& scene_name, Scene* scene, Camera* camera,
+                        const CameraPath& camera_path, Renderer* renderer, uint32_t width, uint32_t height)
+{
+    GoldenResult result;
+    if (!fits_id_encoding(scene))
+    {
+        result.passed = false;
+        result.error = "scene has too many meshes or triangles for the 32 bit id images";
+        return result;
+    }
+
+    CpuRasterizer* rasterizer = options.cpu ? new CpuRasterizer() : nullptr;
+    CpuTriangleFiltering triangle_filtering;
+    ClusterCullingResult culling_result;
+    EzTexture color_target = options.cpu ? VK_NULL_HANDLE : Renderer::create_offscreen_target(width, height);
+    EzTexture vb_target = options.cpu ? VK_NULL_HANDLE : create_capture_target(width, height);
+
+    for (uint32_t view = 0; view < options.view_count; ++view)
+    {
+        camera_path.apply(camera, (float)view / (float)options.view_count);
+        std::string name = scene_name + "_view" + std::to_string(view);
+
+        std::vector<uint8_t> vb_pixels;
+        std::vector<uint8_t> mesh_pixels;
+        std::vector<uint8_t> triangle_pixels;
+        if (rasterizer)
+        {
+            cull_clusters(scene, camera->get_translation(), culling_result);
+            triangle_filtering.filter(scene, camera->get_proj_matrix() * camera->get_view_matrix(), culling_result);
+            rasterizer->render(scene, camera, triangle_filtering.get_filtered_indices(), triangle_filtering.get_draw_commands(), width, height);
+            rasterizer->get_visibility_buffer_bgra(vb_pixels);
+            resolve_ids(scene, triangle_filtering.get_filtered_indices(), triangle_filtering.get_draw_commands(),
+                        triangle_filtering.get_draw_mesh_indices(), vb_pixels, mesh_pixels, triangle_pixels);
+        }
+        else
+        {
+            renderer->capture_visibility_buffer(vb_target);
+            renderer->render(color_target);
+            ez_submit();
+
+            std::vector<uint8_t> color_pixels;
+            readback_texture(color_target, VK_IMAGE_ASPECT_COLOR_BIT, width, height, 4, color_pixels);
+            readback_texture(vb_target, VK_IMAGE_ASPECT_COLOR_BIT, width, height, 4, vb_pixels);
+
+            std::vector<uint32_t> indices;
+            std::vector<DrawCommand> draw_commands;
+            std::vector<uint32_t> draw_mesh_indices;
+            renderer->read_filtered_draws(indices, draw_commands, draw_mesh_indices);
+            resolve_ids(scene, indices, draw_commands, draw_mesh_indices, vb_pixels, mesh_pixels, triangle_pixels);
+            result.images.push_back(check_image(options, name + "_color", false, color_pixels, width, height));
+        }
+
+        // Resolved ids do not depend on the draw order, both paths share the golden and each one also checks the other
+        result.images.push_back(check_image(options, name + "_vb_mesh", true, mesh_pixels, width, height));
+        result.images.push_back(check_image(options, name + "_vb_triangle", true, triangle_pixels, width, height));
+    }
+
+    for (auto& image : result.images)
+    {
+        result.passed = result.passed && image.passed;
+    }
+
+    if (color_target)
+        ez_destroy_texture(color_target);
+    if (vb_target)
+        ez_destroy_texture(vb_target);
+    delete rasterizer;
+    return result;
+}
+
+void write_golden_result(std::ostream& out, const GoldenResult& result)
+{
+    out << "{\"passed\": " << (result.passed ? "true" : "false");
+    if (!result.error.empty())
+        out << ", \"error\": \"" << result.error << "\"";
+    out << ", \"images\": [";
+    for (size_t i = 0; i < result.images.size(); ++i)
+    {
+        const GoldenImageResult& image = result.images[i];
+        out << (i > 0 ? ", " : "") << "{\"name\": \"" << image.name << "\""
+            << ", \"passed\": " << (image.passed ? "true" : "false")
+            << ", \"missing\": " << (image.missing ? "true" : "false")
+            << ", \"mismatch_count\": " << image.compare.mismatch_count
+            << ", \"max_difference\": " << image.compare.max_difference << "}";
+    }
+    out << "]}";
+}
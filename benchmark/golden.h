@@ -0,0 +1,50 @@
+#pragma once
+
+#include "image_io.h"
+#include <ostream>
+#include <string>
+#include <vector>
+
+class Scene;
+class Camera;
+class CameraPath;
+class Renderer;
+
+struct GoldenOptions
+{
+    std::string directory;
+    // Overwrite the golden images instead of comparing against them
+    bool update = false;
+    // Visibility buffer from the CPU rasterizer, there is no shaded color on that path
+    bool cpu = false;
+    uint32_t view_count = 4;
+    uint32_t color_tolerance = 2;
+    double max_color_mismatch_ratio = 0.001;
+    // IDs are compared exactly, a few edge pixels may still differ between rasterizers
+    double max_id_mismatch_ratio = 0.0005;
+};
+
+struct GoldenImageResult
+{
+    std::string name;
+    ImageCompareResult compare;
+    bool missing = false;
+    bool passed = false;
+};
+
+struct GoldenResult
+{
+    std::vector<GoldenImageResult> images;
+    bool passed = true;
+    // Set when the scene cannot be checked at all
+    std::string error;
+};
+
+// Renders fixed views along the camera path and compares visibility buffer IDs and shaded color
+// against the golden images, writing <name>_diff.ppm next to every image that does not match. IDs
+// are compared as a mesh and a source triangle image, the draw and primitive ids depend on the
+// compaction order. Scenes whose meshes or triangles do not fit in 32 bit ids fail without rendering.
+GoldenResult run_golden(const GoldenOptions& options, const std::string& scene_name, Scene* scene, Camera* camera,
+                        const CameraPath& camera_path, Renderer* renderer, uint32_t width, uint32_t height);
+
+void write_golden_result(std::ostream& out, const GoldenResult& result);
@@ -0,0 +1,393 @@
+#include "scene.h"
+#include "scene_importer.h"
+#include "cluster_culling.h"
+#include "parallel.h"
+#include <cgltf.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+struct MicrobenchmarkOptions
+{
+    std::vector<uint32_t> triangle_counts = {16384, 262144, 1048576};
+    std::vector<uint32_t> cluster_sizes = {64, 128, 256};
+    std::vector<uint32_t> thread_counts = {1, 2, 4, 0};
+    std::vector<uint32_t> hierarchy_depths = {1, 4, 16, 64};
+    // Every case repeats until it ran for min_time seconds and at least min_iteration_count times
+    double min_time = 0.25;
+    uint32_t min_iteration_count = 5;
+    std::string filter;
+    std::string output;
+    bool csv = false;
+};
+
+struct MicrobenchmarkResult
+{
+    std::string name;
+    uint32_t triangle_count = 0;
+    uint32_t cluster_size = 0;
+    uint32_t thread_count = 0;
+    uint32_t depth = 0;
+    // Work items of one iteration (indices, triangles, clusters, nodes or points)
+    uint64_t item_count = 0;
+    std::vector<double> times;
+};
+
+static std::vector<uint32_t> split_uint(const std::string& value)
+{
+    std::vector<uint32_t> parts;
+    std::stringstream stream(value);
+    std::string part;
+    while (std::getline(stream, part, ','))
+    {
+        if (!part.empty())
+            parts.push_back((uint32_t)atoi(part.c_str()));
+    }
+    return parts;
+}
+
+static MicrobenchmarkOptions parse_options(int argc, char** argv)
+{
+    MicrobenchmarkOptions options;
+    for (int i = 1; i < argc; ++i)
+    {
+        bool has_value = i + 1 < argc;
+        if (strcmp(argv[i], "--triangles") == 0 && has_value)
+            options.triangle_counts = split_uint(argv[++i]);
+        else if (strcmp(argv[i], "--cluster-sizes") == 0 && has_value)
+            options.cluster_sizes = split_uint(argv[++i]);
+        else if (strcmp(argv[i], "--threads") == 0 && has_value)
+            options.thread_counts = split_uint(argv[++i]);
+        else if (strcmp(argv[i], "--depths") == 0 && has_value)
+            options.hierarchy_depths = split_uint(argv[++i]);
+        else if (strcmp(argv[i], "--min-time") == 0 && has_value)
+            options.min_time = atof(argv[++i]);
+        else if (strcmp(argv[i], "--min-iterations") == 0 && has_value)
+            options.min_iteration_count = (uint32_t)atoi(argv[++i]);
+        else if (strcmp(argv[i], "--filter") == 0 && has_value)
+            options.filter = argv[++i];
+        else if (strcmp(argv[i], "--output") == 0 && has_value)
+            options.output = argv[++i];
+        else if (strcmp(argv[i], "--csv") == 0)
+            options.csv = true;
+    }
+
+    // The builder is only specialized for the sizes the GPU filtering supports
+    auto unsupported = [](uint32_t cluster_size) { return !is_supported_cluster_size(cluster_size); };
+    options.cluster_sizes.erase(std::remove_if(options.cluster_sizes.begin(), options.cluster_sizes.end(), unsupported), options.cluster_sizes.end());
+    return options;
+}
+
+// Keeps the compiler from dropping the measured work
+static volatile uint64_t g_sink = 0;
+
+template <typename F>
+static void run_case(const MicrobenchmarkOptions& options, MicrobenchmarkResult& result, F func)
+{
+    // Warm caches and thread stacks once before measuring
+    func();
+
+    double total_time = 0.0;
+    while (result.times.size() < options.min_iteration_count || total_time < options.min_time)
+    {
+        auto begin = std::chrono::high_resolution_clock::now();
+        func();
+        auto end = std::chrono::high_resolution_clock::now();
+        double time = std::chrono::duration<double, std::milli>(end - begin).count();
+        result.times.push_back(time);
+        total_time += time / 1000.0;
+    }
+}
+
+// Height field with (grid_size * grid_size * 2) triangles, bumpy enough to give the clusters distinct cones
+struct SyntheticMesh
+{
+    std::vector<float> positions;
+    std::vector<uint32_t> indices;
+    uint32_t triangle_count = 0;
+};
+
+static SyntheticMesh create_mesh(uint32_t triangle_count)
+{
+    uint32_t grid_size = std::max(1u, (uint32_t)std::sqrt((double)triangle_count / 2.0));
+    SyntheticMesh mesh;
+    for (uint32_t y = 0; y <= grid_size; ++y)
+    {
+        for (uint32_t x = 0; x <= grid_size; ++x)
+        {
+            float fx = (float)x / (float)grid_size;
+            float fy = (float)y / (float)grid_size;
+            mesh.positions.push_back(fx * 100.0f);
+            mesh.positions.push_back(std::sin(fx * 40.0f) * std::cos(fy * 30.0f) * 2.0f);
+            mesh.positions.push_back(fy * 100.0f);
+        }
+    }
+    for (uint32_t y = 0; y < grid_size; ++y)
+    {
+        for (uint32_t x = 0; x < grid_size; ++x)
+        {
+            uint32_t i0 = y * (grid_size + 1) + x;
+            uint32_t i1 = i0 + 1;
+            uint32_t i2 = i0 + grid_size + 1;
+            uint32_t i3 = i2 + 1;
+            uint32_t quad[6] = {i0, i2, i1, i1, i2, i3};
+            mesh.indices.insert(mesh.indices.end(), quad, quad + 6);
+        }
+    }
+    mesh.triangle_count = (uint32_t)mesh.indices.size() / 3;
+    return mesh;
+}
+
+static bool is_enabled(const MicrobenchmarkOptions& options, const std::string& name)
+{
+    return options.filter.empty() || name.find(options.filter) != std::string::npos;
+}
+
+static void run_index_widening(const MicrobenchmarkOptions& options, std::vector<MicrobenchmarkResult>& results)
+{
+    if (!is_enabled(options, "index_widening"))
+        return;
+
+    for (auto triangle_count : options.triangle_counts)
+    {
+        uint32_t index_count = triangle_count * 3;
+        std::vector<uint16_t> src(index_count);
+        for (uint32_t i = 0; i < index_count; ++i)
+        {
+            src[i] = (uint16_t)(i * 7919u);
+        }
+        std::vector<uint32_t> dst(index_count);
+
+        MicrobenchmarkResult result;
+        result.name = "index_widening";
+        result.triangle_count = triangle_count;
+        result.item_count = index_count;
+        run_case(options, result, [&]() {
+            widen_indices(src.data(), index_count, dst.data());
+            g_sink += dst[index_count - 1];
+        });
+        results.push_back(result);
+    }
+}
+
+static void run_build_clusters(const MicrobenchmarkOptions& options, std::vector<MicrobenchmarkResult>& results)
+{
+    if (!is_enabled(options, "build_clusters"))
+        return;
+
+    for (auto triangle_count : options.triangle_counts)
+    {
+        SyntheticMesh synthetic_mesh = create_mesh(triangle_count);
+        for (auto cluster_size : options.cluster_sizes)
+        {
+            for (auto thread_count : options.thread_counts)
+            {
+                MicrobenchmarkResult result;
+                result.name = "build_clusters";
+                result.triangle_count = synthetic_mesh.triangle_count;
+                result.cluster_size = cluster_size;
+                result.thread_count = get_worker_thread_count(thread_count);
+                result.item_count = synthetic_mesh.triangle_count;
+                run_case(options, result, [&]() {
+                    Mesh mesh;
+                    build_clusters(synthetic_mesh.positions.data(), synthetic_mesh.indices.data(), synthetic_mesh.triangle_count, cluster_size, result.thread_count, mesh);
+                    g_sink += mesh.clusters.size();
+                });
+                results.push_back(result);
+            }
+        }
+    }
+}
+
+static void run_world_matrix(const MicrobenchmarkOptions& options, std::vector<MicrobenchmarkResult>& results)
+{
+    if (!is_enabled(options, "world_matrix"))
+        return;
+
+    for (auto depth : options.hierarchy_depths)
+    {
+        // Chain of depth nodes with a full TRS each, the leaf is evaluated
+        std::vector<cgltf_node> nodes(std::max(1u, depth));
+        memset(nodes.data(), 0, nodes.size() * sizeof(cgltf_node));
+        for (size_t i = 0; i < nodes.size(); ++i)
+        {
+            cgltf_node& node = nodes[i];
+            node.parent = i > 0 ? &nodes[i - 1] : nullptr;
+            node.has_translation = 1;
+            node.translation[0] = (float)i;
+            node.translation[1] = 0.5f;
+            node.translation[2] = -1.0f;
+            node.has_rotation = 1;
+            node.rotation[0] = 0.0f;
+            node.rotation[1] = 0.38268343f;
+            node.rotation[2] = 0.0f;
+            node.rotation[3] = 0.92387953f;
+            node.has_scale = 1;
+            node.scale[0] = node.scale[1] = node.scale[2] = 1.01f;
+        }
+
+        const uint32_t evaluation_count = 1024;
+        MicrobenchmarkResult result;
+        result.name = "world_matrix";
+        result.depth = (uint32_t)nodes.size();
+        result.item_count = evaluation_count * nodes.size();
+        run_case(options, result, [&]() {
+            float sum = 0.0f;
+            for (uint32_t i = 0; i < evaluation_count; ++i)
+            {
+                sum += get_world_matrix(&nodes.back())[3][0];
+            }
+            g_sink += (uint64_t)sum;
+        });
+        results.push_back(result);
+    }
+}
+
+static void run_cull_clusters(const MicrobenchmarkOptions& options, std::vector<MicrobenchmarkResult>& results)
+{
+    if (!is_enabled(options, "cull_clusters"))
+        return;
+
+    for (auto triangle_count : options.triangle_counts)
+    {
+        SyntheticMesh synthetic_mesh = create_mesh(triangle_count);
+        for (auto cluster_size : options.cluster_sizes)
+        {
+            Scene scene;
+            Mesh mesh;
+            build_clusters(synthetic_mesh.positions.data(), synthetic_mesh.indices.data(), synthetic_mesh.triangle_count, cluster_size, 0, mesh);
+            scene.meshs.push_back(mesh);
+
+            // Mesh order, front to back order, and front to back with cached cone tests under a slowly moving camera
+            const char* names[] = {"cull_clusters", "cull_clusters_front_to_back", "cull_clusters_incremental"};
+            for (int mode = 0; mode < 3; ++mode)
+            {
+                ClusterCullingResult culling_result;
+                MicrobenchmarkResult result;
+                result.name = names[mode];
+                result.triangle_count = synthetic_mesh.triangle_count;
+                result.cluster_size = cluster_size;
+                result.thread_count = 1;
+                result.item_count = mesh.clusters.size();
+                glm::vec3 camera_position = glm::vec3(50.0f, 40.0f, -20.0f);
+                run_case(options, result, [&]() {
+                    if (mode == 2)
+                        camera_position = camera_position + glm::vec3(0.01f, 0.0f, 0.005f);
+                    cull_clusters(&scene, camera_position, culling_result, mode != 0, mode == 2);
+                    g_sink += culling_result.batches.size();
+                });
+                results.push_back(result);
+            }
+        }
+    }
+}
+
+static void run_bounding_box_merge(const MicrobenchmarkOptions& options, std::vector<MicrobenchmarkResult>& results)
+{
+    if (!is_enabled(options, "bounding_box_merge"))
+        return;
+
+    for (auto triangle_count : options.triangle_counts)
+    {
+        SyntheticMesh synthetic_mesh = create_mesh(triangle_count);
+        uint32_t point_count = (uint32_t)synthetic_mesh.positions.size() / 3;
+
+        MicrobenchmarkResult result;
+        result.name = "bounding_box_merge";
+        result.triangle_count = synthetic_mesh.triangle_count;
+        result.item_count = point_count;
+        run_case(options, result, [&]() {
+            BoundingBox bounds;
+            const float* positions = synthetic_mesh.positions.data();
+            for (uint32_t i = 0; i < point_count; ++i)
+            {
+                bounds.merge(glm::vec3(positions[i * 3], positions[i * 3 + 1], positions[i * 3 + 2]));
+            }
+            g_sink += (uint64_t)bounds.bb_max.x;
+        });
+        results.push_back(result);
+    }
+}
+
+struct TimeSummary
+{
+    double min;
+    double mean;
+    double p50;
+    double max;
+};
+
+static TimeSummary summarize(std::vector<double> times)
+{
+    std::sort(times.begin(), times.end());
+    double sum = 0.0;
+    for (auto time : times)
+    {
+        sum += time;
+    }
+    return {times.front(), sum / (double)times.size(), times[times.size() / 2], times.back()};
+}
+
+static void write_json(std::ostream& out, const std::vector<MicrobenchmarkResult>& results)
+{
+    out << "{\n";
+    out << "  \"hardware_threads\": " << get_worker_thread_count(0) << ",\n";
+    out << "  \"cases\": [\n";
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        const MicrobenchmarkResult& result = results[i];
+        TimeSummary summary = summarize(result.times);
+        out << "    {\"name\": \"" << result.name << "\""
+            << ", \"triangle_count\": " << result.triangle_count
+            << ", \"cluster_size\": " << result.cluster_size
+            << ", \"thread_count\": " << result.thread_count
+            << ", \"depth\": " << result.depth
+            << ", \"iterations\": " << result.times.size()
+            << ", \"time_ms\": {\"min\": " << summary.min << ", \"mean\": " << summary.mean << ", \"p50\": " << summary.p50 << ", \"max\": " << summary.max << "}"
+            << ", \"items_per_second\": " << (double)result.item_count / (summary.p50 / 1000.0) << "}"
+            << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n";
+    out << "}\n";
+}
+
+static void write_csv(std::ostream& out, const std::vector<MicrobenchmarkResult>& results)
+{
+    out << "name,triangle_count,cluster_size,thread_count,depth,iterations,min_ms,mean_ms,p50_ms,max_ms,items_per_second\n";
+    for (auto& result : results)
+    {
+        TimeSummary summary = summarize(result.times);
+        out << result.name << "," << result.triangle_count << "," << result.cluster_size << "," << result.thread_count << "," << result.depth << ","
+            << result.times.size() << "," << summary.min << "," << summary.mean << "," << summary.p50 << "," << summary.max << ","
+            << (double)result.item_count / (summary.p50 / 1000.0) << "\n";
+    }
+}
+
+int main(int argc, char** argv)
+{
+    MicrobenchmarkOptions options = parse_options(argc, argv);
+
+    std::vector<MicrobenchmarkResult> results;
+    run_index_widening(options, results);
+    run_build_clusters(options, results);
+    run_world_matrix(options, results);
+    run_cull_clusters(options, results);
+    run_bounding_box_merge(options, results);
+
+    if (options.output.empty())
+    {
+        options.csv ? write_csv(std::cout, results) : write_json(std::cout, results);
+    }
+    else
+    {
+        std::ofstream file(options.output);
+        options.csv ? write_csv(file, results) : write_json(file, results);
+    }
+    return 0;
+}
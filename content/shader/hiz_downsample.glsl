@@ -0,0 +1,61 @@
+// Shared body of the hiz_downsample*.comp variants. Writes the min and max depth of the source
+// texels covered by each destination texel, DEPTH_SOURCE reads the depth buffer for the first mip.
+// Mip sizes round down, the last row and column also take the leftover odd source texels.
+
+#if defined(DEPTH_SOURCE)
+layout(binding = 0) uniform texture2D depth_tex;
+layout(binding = 1) uniform sampler depth_sampler;
+#else
+layout(binding = 0, rg32f) uniform restrict readonly image2D src_image;
+#endif
+
+layout(binding = 2, rg32f) uniform restrict writeonly image2D dst_image;
+
+ivec2 get_source_size()
+{
+#if defined(DEPTH_SOURCE)
+    return textureSize(sampler2D(depth_tex, depth_sampler), 0);
+#else
+    return imageSize(src_image);
+#endif
+}
+
+vec2 load_source(ivec2 coord)
+{
+#if defined(DEPTH_SOURCE)
+    return texelFetch(sampler2D(depth_tex, depth_sampler), coord, 0).rr;
+#else
+    return imageLoad(src_image, coord).rg;
+#endif
+}
+
+layout(local_size_x = 8, local_size_y = 8, local_size_z = 1) in;
+void main()
+{
+    ivec2 dst_size = imageSize(dst_image);
+    ivec2 dst_coord = ivec2(gl_GlobalInvocationID.xy);
+    if (dst_coord.x >= dst_size.x || dst_coord.y >= dst_size.y)
+        return;
+
+    ivec2 src_size = get_source_size();
+    ivec2 src_begin = dst_coord * 2;
+    ivec2 src_end = min(src_begin + 2, src_size);
+    if (dst_coord.x == dst_size.x - 1)
+        src_end.x = src_size.x;
+    if (dst_coord.y == dst_size.y - 1)
+        src_end.y = src_size.y;
+
+    // Reversed-Z: x is the farthest depth, y the nearest
+    vec2 min_max = vec2(1.0, 0.0);
+    for (int y = src_begin.y; y < src_end.y; ++y)
+    {
+        for (int x = src_begin.x; x < src_end.x; ++x)
+        {
+            vec2 value = load_source(ivec2(x, y));
+            min_max.x = min(min_max.x, value.x);
+            min_max.y = max(min_max.y, value.y);
+        }
+    }
+
+    imageStore(dst_image, dst_coord, vec4(min_max, 0.0, 0.0));
+}
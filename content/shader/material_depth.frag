@@ -0,0 +1,41 @@
+#version 450
+
+#extension GL_GOOGLE_include_directive : enable
+
+#include "shader_defs.glsl"
+
+// Writes the material of every covered pixel as depth, the per material shading draws then test
+// for equality and the hardware rejects every other pixel before the fragment shader runs
+
+layout(location = 0) in vec2 in_screen_pos;
+
+layout(binding = 0) uniform texture2D vb_tex;
+layout(binding = 1) uniform sampler vb_sampler;
+
+layout(std140, binding = 2) uniform ViewBuffer
+{
+    ViewConstants data;
+} view_buffer;
+
+layout(std430, binding = 3) restrict readonly buffer MeshConstantsBufferBlock
+{
+    MeshConstants data[];
+} mesh_constants_buffer;
+
+layout(std430, binding = 4) restrict readonly buffer DrawMeshBufferBlock
+{
+    uint data[];
+} draw_mesh_buffer;
+
+void main()
+{
+    uint draw_id_tri_id = packUnorm4x8(texelFetch(sampler2D(vb_tex, vb_sampler), ivec2(gl_FragCoord.xy), 0));
+    // The cleared depth of 0 matches no material
+    if (draw_id_tri_id == ~0)
+        discard;
+
+    uint draw_id = (draw_id_tri_id >> 23) & uint(0x000000FF);
+    uint mesh_index = draw_mesh_buffer.data[draw_id];
+    uint material = min(mesh_constants_buffer.data[mesh_index].material_index, view_buffer.data.tile_count.w - 1);
+    gl_FragDepth = float(material + 1) * MATERIAL_DEPTH_SCALE;
+}
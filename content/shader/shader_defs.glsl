@@ -2,11 +2,29 @@
 #define SHADER_DEFS_H
 
 #define MAX_DRAW_CMD_COUNT 256
+#define SHADOW_CASCADE_COUNT 4
+// Side of one cascade in the shadow atlas
+#define SHADOW_MAP_SIZE 1024
+// Light space cells per side of every cascade, one bit per cell and one uint per row
+#define RECEIVER_MASK_SIZE 32
+// Pixels per side of the screen tiles the lights and materials are binned into
+#define SCREEN_TILE_SIZE 16
+// Lights one tile can hold
+#define MAX_LIGHTS_PER_TILE 128
+
+// Materials one scene can use, one bit each in the classification's tile mask
+#define MAX_MATERIALS 1024
+// Material i is drawn into the material depth at (i + 1) * MATERIAL_DEPTH_SCALE, exact in D32
+#define MATERIAL_DEPTH_SCALE (1.0 / 1048576.0)
+
+#define LIGHT_TYPE_POINT 0
+#define LIGHT_TYPE_SPOT 1
 
 struct MeshConstants
 {
     uint face_count;
     uint index_offset;
+    uint material_index;
 };
 
 struct SmallBatchData
@@ -17,12 +35,66 @@ struct SmallBatchData
     uint output_index_offset;
     uint draw_batch_start;
     uint accum_draw_index;
+    uint view_index;
 };
 
 struct UncompactedDrawCommand
 {
     uint num_indices;
     uint start_index;
+    uint mesh_index;
+};
+
+struct ViewConstants
+{
+    mat4 view_matrix;
+    mat4 proj_matrix;
+    mat4 view_proj_matrix;
+    mat4 inv_view_proj_matrix;
+    mat4 prev_view_proj_matrix;
+    vec4 frustum_planes[6];
+    vec4 viewport;
+    vec4 jitter;
+    vec4 camera_position;
+    // xyz: direction the light travels, w: 1 with shadows
+    vec4 sun_direction;
+    mat4 shadow_matrices[SHADOW_CASCADE_COUNT];
+    vec4 shadow_split_distances;
+    vec4 shadow_texel_sizes;
+    // xy: screen tiles, z: light count, w: material count
+    uvec4 tile_count;
+};
+
+struct Light
+{
+    vec3 position;
+    float range;
+    vec3 color;
+    uint type;
+    vec3 direction;
+    float spot_cos_outer;
+    float spot_cos_inner;
+};
+
+// glTF metallic-roughness factors, one uniform range per material
+struct MaterialConstants
+{
+    vec4 base_color;
+    // xyz: emissive, w: unused
+    vec4 emissive;
+    float metallic;
+    float roughness;
+    uint index;
+    uint padding;
+};
+
+// Culling counters, read back on the CPU a few frames late
+struct DrawCounter
+{
+    uint count;
+    uint batch_count;
+    uint input_triangle_count;
+    uint output_triangle_count;
 };
 
 struct DrawIndexedIndirectCommand
@@ -0,0 +1,15 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+layout(location = 0) in vec3 in_position;
+
+// Matrix of the cascade being drawn, bound at its offset
+layout(std140, binding = 0) uniform CascadeBuffer
+{
+    mat4 view_proj_matrix;
+} cascade_buffer;
+
+void main()
+{
+    gl_Position = cascade_buffer.view_proj_matrix * vec4(in_position, 1);
+}
@@ -1,6 +1,6 @@
-#version 450
-
-#extension GL_GOOGLE_include_directive : enable
+// Shared body of the triangle_filtering_<size>.comp variants, each one defines CLUSTER_SIZE
+// to the cluster size the scene was cooked with, one work group filters one cluster.
+// The receiver mask variants also define RECEIVER_MASK.
 
 #include "shader_defs.glsl"
 
@@ -39,18 +39,77 @@ layout(std430, binding = 5) restrict buffer UncompactedDrawCommandBufferBlock
     UncompactedDrawCommand data[];
 } uncompacted_draw_command_buffer;
 
-layout(std140, binding = 6) uniform ViewBuffer
+// Indexed with the view_index of the batch
+layout(std430, binding = 6) restrict readonly buffer ViewProjBufferBlock
+{
+    mat4 data[];
+} view_proj_buffer;
+
+layout(std430, binding = 7) restrict buffer DrawCounterBlock
+{
+    DrawCounter data;
+} draw_counter;
+
+// Conservative, only triangles that can not cover any pixel are removed since the
+// visibility buffer pass rasterizes both windings
+bool filter_triangle(uint indices[3], vec4 vertices[3])
+{
+    // Degenerate
+    if (indices[0] == indices[1] || indices[1] == indices[2] || indices[0] == indices[2])
+        return true;
+
+    // Completely outside one frustum plane, reversed-Z: z > w is nearer to the camera than the near plane
+    for (int axis = 0; axis < 2; ++axis)
+    {
+        if (vertices[0][axis] > vertices[0].w && vertices[1][axis] > vertices[1].w && vertices[2][axis] > vertices[2].w)
+            return true;
+        if (vertices[0][axis] < -vertices[0].w && vertices[1][axis] < -vertices[1].w && vertices[2][axis] < -vertices[2].w)
+            return true;
+    }
+    if (vertices[0].z > vertices[0].w && vertices[1].z > vertices[1].w && vertices[2].z > vertices[2].w)
+        return true;
+    if (vertices[0].z < 0.0 && vertices[1].z < 0.0 && vertices[2].z < 0.0)
+        return true;
+
+    return false;
+}
+
+#ifdef RECEIVER_MASK
+// Light space cells of every view that hold visible receivers, RECEIVER_MASK_SIZE rows per view
+layout(std430, binding = 8) restrict readonly buffer ReceiverMaskBufferBlock
 {
-    mat4 view_matrix;
-    mat4 proj_matrix;
-    mat4 pad0;
-    mat4 pad1;
-} view_buffer;
+    uint data[];
+} receiver_mask_buffer;
+
+// Along an orthographic view the triangle can only shadow the cells its xy bounds cover
+bool covers_receiver(uint view_index, vec4 vertices[3])
+{
+    if (vertices[0].w <= 0.0 || vertices[1].w <= 0.0 || vertices[2].w <= 0.0)
+        return true;
+
+    vec2 p0 = vertices[0].xy / vertices[0].w;
+    vec2 p1 = vertices[1].xy / vertices[1].w;
+    vec2 p2 = vertices[2].xy / vertices[2].w;
+    vec2 bounds_min = min(p0, min(p1, p2));
+    vec2 bounds_max = max(p0, max(p1, p2));
+    ivec2 cell_min = clamp(ivec2(floor((bounds_min * 0.5 + 0.5) * RECEIVER_MASK_SIZE)), ivec2(0), ivec2(RECEIVER_MASK_SIZE - 1));
+    ivec2 cell_max = clamp(ivec2(floor((bounds_max * 0.5 + 0.5) * RECEIVER_MASK_SIZE)), ivec2(0), ivec2(RECEIVER_MASK_SIZE - 1));
+
+    uint cell_count = uint(cell_max.x - cell_min.x + 1);
+    uint row_bits = cell_count == 32 ? ~0u : ((1u << cell_count) - 1u) << uint(cell_min.x);
+    for (int y = cell_min.y; y <= cell_max.y; ++y)
+    {
+        if ((receiver_mask_buffer.data[view_index * RECEIVER_MASK_SIZE + y] & row_bits) != 0)
+            return true;
+    }
+    return false;
+}
+#endif
 
 shared uint work_group_output_slot;
 shared uint work_group_index_count;
 
-layout(local_size_x = 256, local_size_y = 1, local_size_z = 1) in;
+layout(local_size_x = CLUSTER_SIZE, local_size_y = 1, local_size_z = 1) in;
 void main()
 {
     if (gl_LocalInvocationID.x == 0)
@@ -83,7 +142,7 @@ void main()
             vec4(vertex_data_buffer.data[indices[2]].x, vertex_data_buffer.data[indices[2]].y, vertex_data_buffer.data[indices[2]].z, 1.0)
         };
 
-        mat4 mvp = view_buffer.proj_matrix * view_buffer.view_matrix;
+        mat4 mvp = view_proj_buffer.data[batch_buffer.data[gl_WorkGroupID.x].view_index];
         vec4 vertices[3] =
         {
             mvp * raw_vertices[0],
@@ -91,8 +150,11 @@ void main()
             mvp * raw_vertices[2]
         };
 
-        // TODO: FilterTriangle
-        cull = false;
+        cull = filter_triangle(indices, vertices);
+#ifdef RECEIVER_MASK
+        if (!cull)
+            cull = !covers_receiver(batch_buffer.data[gl_WorkGroupID.x].view_index, vertices);
+#endif
         if (!cull)
         {
             thread_output_slot = atomicAdd(work_group_index_count, 3);
@@ -105,6 +167,10 @@ void main()
         if (gl_LocalInvocationID.x == 0)
         {
             work_group_output_slot = atomicAdd(uncompacted_draw_command_buffer.data[batch_draw_index].num_indices, work_group_index_count);
+
+            atomicAdd(draw_counter.data.batch_count, 1);
+            atomicAdd(draw_counter.data.input_triangle_count, batch_buffer.data[gl_WorkGroupID.x].face_count);
+            atomicAdd(draw_counter.data.output_triangle_count, work_group_index_count / 3);
         }
 
         groupMemoryBarrier();
@@ -121,6 +187,7 @@ void main()
         if (gl_LocalInvocationID.x == 0 && gl_WorkGroupID.x == batch_buffer.data[gl_WorkGroupID.x].draw_batch_start)
         {
             uncompacted_draw_command_buffer.data[batch_draw_index].start_index = batch_buffer.data[gl_WorkGroupID.x].output_index_offset;
+            uncompacted_draw_command_buffer.data[batch_draw_index].mesh_index = batch_mesh_index;
         }
     }
 }
\ No newline at end of file
@@ -0,0 +1,295 @@
+// Based on The Forge's Visibility Buffer implementation.
+// <https://github.com/ConfettiFX/The-Forge/blob/v1.45/Examples_3/Visibility_Buffer/src/Shaders/Vulkan/visibilityBuffer_shade.frag>
+
+// Shared body of the visibility_buffer_shading_pass*.frag variants, SHADOWS samples the cascaded
+// shadow atlas of the sun. Drawn once per material over the tiles listed for it, the material
+// depth test leaves only that material's pixels, so the factors are uniform across the draw.
+
+#include "shader_defs.glsl"
+
+layout(location = 0) in vec2 in_screen_pos;
+layout(location = 0) out vec4 out_color;
+
+layout(binding = 0) uniform texture2D vb_tex;
+layout(binding = 1) uniform sampler vb_sampler;
+
+struct Vertex
+{
+    float x, y, z;
+};
+
+struct Normal
+{
+    float x, y, z;
+};
+
+struct UV
+{
+    float u, v;
+};
+
+layout(std430, binding = 2) restrict readonly buffer VertexDataBufferBlock
+{
+    Vertex data[];
+} vertex_data_buffer;
+
+layout(std430, binding = 3) restrict readonly buffer NormalDataBufferBlock
+{
+    Normal data[];
+} normal_data_buffer;
+
+layout(std430, binding = 4) restrict readonly buffer UVDataBufferBlock
+{
+    UV data[];
+} uv_data_buffer;
+
+layout(std430, binding = 5) restrict readonly buffer FilteredIndicesBufferBlock
+{
+    uint data[];
+} filtered_indices_buffer;
+
+layout(std430, binding = 6) restrict buffer DrawCommandBufferBlock
+{
+    DrawIndexedIndirectCommand data[];
+} draw_command_buffer;
+
+layout(std140, binding = 7) uniform ViewBuffer
+{
+    ViewConstants data;
+} view_buffer;
+
+layout(std430, binding = 9) restrict readonly buffer LightBufferBlock
+{
+    Light data[];
+} light_buffer;
+
+// Light count of every tile, see light_culling.comp
+layout(std430, binding = 10) restrict readonly buffer LightGridBufferBlock
+{
+    uint data[];
+} light_grid_buffer;
+
+// MAX_LIGHTS_PER_TILE light indices per tile
+layout(std430, binding = 11) restrict readonly buffer LightIndexBufferBlock
+{
+    uint data[];
+} light_index_buffer;
+
+layout(std140, binding = 12) uniform MaterialBuffer
+{
+    MaterialConstants data;
+} material_buffer;
+
+#define PI 3.14159265359
+
+struct Surface
+{
+    vec3 position;
+    vec3 normal;
+    vec3 view_direction;
+    vec3 diffuse_color;
+    vec3 specular_color;
+    float alpha;
+};
+
+Surface get_surface(vec3 position, vec3 normal)
+{
+    vec3 base_color = material_buffer.data.base_color.rgb;
+    float metallic = material_buffer.data.metallic;
+    float roughness = max(material_buffer.data.roughness, 0.05);
+
+    Surface surface;
+    surface.position = position;
+    surface.normal = normal;
+    surface.view_direction = normalize(view_buffer.data.camera_position.xyz - position);
+    surface.diffuse_color = base_color * (1.0 - metallic);
+    surface.specular_color = mix(vec3(0.04), base_color, metallic);
+    surface.alpha = roughness * roughness;
+    return surface;
+}
+
+// Lambert plus GGX specular, times pi so a rough white dielectric stays close to plain Lambert
+vec3 shade_light(Surface surface, vec3 light_direction)
+{
+    float n_dot_l = dot(surface.normal, light_direction);
+    if (n_dot_l <= 0.0)
+        return vec3(0.0);
+
+    vec3 half_vector = normalize(light_direction + surface.view_direction);
+    float n_dot_v = max(dot(surface.normal, surface.view_direction), 1e-4);
+    float n_dot_h = max(dot(surface.normal, half_vector), 0.0);
+    float v_dot_h = max(dot(surface.view_direction, half_vector), 0.0);
+
+    float alpha_squared = surface.alpha * surface.alpha;
+    float d = n_dot_h * n_dot_h * (alpha_squared - 1.0) + 1.0;
+    float distribution = alpha_squared / (PI * d * d);
+    // Schlick-GGX visibility, already divided by 4 n_dot_l n_dot_v
+    float k = surface.alpha * 0.5;
+    float visibility = 0.25 / ((n_dot_l * (1.0 - k) + k) * (n_dot_v * (1.0 - k) + k));
+    vec3 fresnel = surface.specular_color + (1.0 - surface.specular_color) * pow(1.0 - v_dot_h, 5.0);
+
+    return (surface.diffuse_color + PI * distribution * visibility * fresnel) * n_dot_l;
+}
+
+// Only the lights listed for the pixel's tile
+vec3 shade_lights(Surface surface)
+{
+    uvec2 tile = min(uvec2(gl_FragCoord.xy) / SCREEN_TILE_SIZE, view_buffer.data.tile_count.xy - 1);
+    uint tile_index = tile.y * view_buffer.data.tile_count.x + tile.x;
+    uint light_count = light_grid_buffer.data[tile_index];
+
+    vec3 lighting = vec3(0.0);
+    for (uint i = 0; i < light_count; ++i)
+    {
+        Light light = light_buffer.data[light_index_buffer.data[tile_index * MAX_LIGHTS_PER_TILE + i]];
+        vec3 to_light = light.position - surface.position;
+        float distance_squared = max(dot(to_light, to_light), 1e-4);
+        vec3 light_direction = to_light * inversesqrt(distance_squared);
+
+        // Inverse square, windowed to reach zero at the range
+        float window = clamp(1.0 - pow(distance_squared / (light.range * light.range), 2.0), 0.0, 1.0);
+        float attenuation = window * window / distance_squared;
+        if (light.type == LIGHT_TYPE_SPOT)
+            attenuation *= smoothstep(light.spot_cos_outer, light.spot_cos_inner, dot(-light_direction, light.direction));
+
+        lighting += light.color * attenuation * shade_light(surface, light_direction);
+    }
+    return lighting;
+}
+
+#if defined(SHADOWS)
+// Reversed-Z, cascade i at x offset i * SHADOW_MAP_SIZE
+layout(binding = 8) uniform texture2D shadow_tex;
+
+float sample_shadow(vec3 position, vec3 normal, float view_distance)
+{
+    int cascade = 0;
+    while (cascade < SHADOW_CASCADE_COUNT - 1 && view_distance > view_buffer.data.shadow_split_distances[cascade])
+        cascade++;
+    if (view_distance > view_buffer.data.shadow_split_distances[SHADOW_CASCADE_COUNT - 1])
+        return 1.0;
+
+    // Normal offset against acne on surfaces at grazing angles to the light
+    float texel_size = view_buffer.data.shadow_texel_sizes[cascade];
+    vec4 light_position = view_buffer.data.shadow_matrices[cascade] * vec4(position + normal * texel_size * 1.5, 1.0);
+    vec2 texel = (light_position.xy * 0.5 + 0.5) * float(SHADOW_MAP_SIZE);
+    float receiver_depth = light_position.z + 0.0005;
+
+    // 3x3 percentage closer filter, clamped to the cascade
+    float lit = 0.0;
+    for (int y = -1; y <= 1; ++y)
+    {
+        for (int x = -1; x <= 1; ++x)
+        {
+            ivec2 coord = clamp(ivec2(texel) + ivec2(x, y), ivec2(0), ivec2(SHADOW_MAP_SIZE - 1));
+            coord.x += cascade * SHADOW_MAP_SIZE;
+            float caster_depth = texelFetch(sampler2D(shadow_tex, vb_sampler), coord, 0).r;
+            lit += caster_depth > receiver_depth ? 0.0 : 1.0;
+        }
+    }
+    return lit / 9.0;
+}
+#endif
+
+struct Derivatives
+{
+    vec3 ddx;
+    vec3 ddy;
+};
+
+Derivatives ComputePartialDerivatives(vec2 v[3])
+{
+    Derivatives derivative;
+    float d = 1.0 / determinant(mat2(v[2] - v[1], v[0] - v[1]));
+    derivative.ddx = vec3(v[1].y - v[2].y, v[2].y - v[0].y, v[0].y - v[1].y) * d;
+    derivative.ddy = vec3(v[2].x - v[1].x, v[0].x - v[2].x, v[1].x - v[0].x) * d;
+    return derivative;
+}
+
+vec3 InterpolateAttribute(mat3 attributes, vec3 ddx, vec3 ddy, vec2 d)
+{
+    vec3 attribute_x = attributes * ddx;
+    vec3 attribute_y = attributes * ddy;
+    vec3 attribute_s = attributes[0];
+
+    return (attribute_s + d.x * attribute_x + d.y * attribute_y);
+}
+
+float InterpolateAttribute(vec3 attributes, vec3 ddx, vec3 ddy, vec2 d)
+{
+    float attribute_x = dot(attributes, ddx);
+    float attribute_y = dot(attributes, ddy);
+    float attribute_s = attributes[0];
+
+    return (attribute_s + d.x * attribute_x + d.y * attribute_y);
+}
+
+void main()
+{
+    vec4 vis_raw = texelFetch(sampler2D(vb_tex, vb_sampler), ivec2(gl_FragCoord.xy), 0);
+    uint draw_id_tri_id = packUnorm4x8(vis_raw);
+
+    if (draw_id_tri_id != ~0)
+    {
+        uint draw_id = (draw_id_tri_id >> 23) & uint(0x000000FF);
+        uint triangle_id = (draw_id_tri_id & uint(0x007FFFFF));
+
+        uint start_index = draw_command_buffer.data[draw_id].first_index;
+
+        uint tri_idx0 = (triangle_id * 3 + 0) + start_index;
+        uint tri_idx1 = (triangle_id * 3 + 1) + start_index;
+        uint tri_idx2 = (triangle_id * 3 + 2) + start_index;
+
+        uint index0 = filtered_indices_buffer.data[tri_idx0];
+        uint index1 = filtered_indices_buffer.data[tri_idx1];
+        uint index2 = filtered_indices_buffer.data[tri_idx2];
+
+        vec3 v0 = vec3(vertex_data_buffer.data[index0].x, vertex_data_buffer.data[index0].y, vertex_data_buffer.data[index0].z);
+        vec3 v1 = vec3(vertex_data_buffer.data[index1].x, vertex_data_buffer.data[index1].y, vertex_data_buffer.data[index1].z);
+        vec3 v2 = vec3(vertex_data_buffer.data[index2].x, vertex_data_buffer.data[index2].y, vertex_data_buffer.data[index2].z);
+
+        mat4 mvp = view_buffer.data.view_proj_matrix;
+        mat4 inv_vp = view_buffer.data.inv_view_proj_matrix;
+
+        vec4 pos0 = mvp * vec4(v0, 1);
+        vec4 pos1 = mvp * vec4(v1, 1);
+        vec4 pos2 = mvp * vec4(v2, 1);
+        vec3 one_over_w = 1.0 / vec3(pos0.w, pos1.w, pos2.w);
+
+        pos0 *= one_over_w[0];
+        pos1 *= one_over_w[1];
+        pos2 *= one_over_w[2];
+
+        vec2 pos_scr[3] = { pos0.xy, pos1.xy, pos2.xy };
+
+        Derivatives derivatives = ComputePartialDerivatives(pos_scr);
+
+        vec2 d = in_screen_pos + -pos_scr[0];
+
+        float w = 1.0 / InterpolateAttribute(one_over_w, derivatives.ddx, derivatives.ddy, d);
+
+        float z = -w * view_buffer.data.proj_matrix[2][2] + view_buffer.data.proj_matrix[3][2];
+
+        vec3 position = (inv_vp * vec4(in_screen_pos * w, z, w)).xyz;
+
+        mat3x3 normals =
+        {
+            vec3(normal_data_buffer.data[index0].x, normal_data_buffer.data[index0].y, normal_data_buffer.data[index0].z) * one_over_w[0],
+            vec3(normal_data_buffer.data[index1].x, normal_data_buffer.data[index1].y, normal_data_buffer.data[index1].z) * one_over_w[1],
+            vec3(normal_data_buffer.data[index2].x, normal_data_buffer.data[index2].y, normal_data_buffer.data[index2].z) * one_over_w[2]
+        };
+
+        vec3 normal = normalize(InterpolateAttribute(normals, derivatives.ddx, derivatives.ddy, d));
+
+        // Shading
+        vec3 sun_direction = view_buffer.data.sun_direction.xyz;
+        float sun_visibility = 1.0;
+#if defined(SHADOWS)
+        sun_visibility = sample_shadow(position, normal, w);
+#endif
+        Surface surface = get_surface(position, normal);
+        vec3 lighting = shade_light(surface, -sun_direction) * sun_visibility + shade_lights(surface);
+        vec3 ambient = material_buffer.data.base_color.rgb * 0.1;
+        out_color = vec4(lighting * vec3(0.6) + ambient + material_buffer.data.emissive.rgb, 1.0);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,6 @@
+#version 450
+
+#extension GL_GOOGLE_include_directive : enable
+
+#define SHADOWS
+#include "visibility_buffer_shading_pass.glsl"
@@ -0,0 +1,38 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_GOOGLE_include_directive : enable
+
+#include "shader_defs.glsl"
+
+// One quad per tile listed for the bound material, at the material's depth
+
+layout(location = 0) in vec3 in_position;
+layout(location = 1) in vec2 in_texcoord;
+layout(location = 0) out vec2 out_screen_pos;
+
+layout(std140, binding = 7) uniform ViewBuffer
+{
+    ViewConstants data;
+} view_buffer;
+
+layout(std140, binding = 12) uniform MaterialBuffer
+{
+    MaterialConstants data;
+} material_buffer;
+
+layout(std430, binding = 13) restrict readonly buffer MaterialTileBufferBlock
+{
+    uint data[];
+} material_tile_buffer;
+
+void main()
+{
+    uint tile_capacity = view_buffer.data.tile_count.x * view_buffer.data.tile_count.y;
+    uint tile = material_tile_buffer.data[material_buffer.data.index * tile_capacity + gl_InstanceIndex];
+    vec2 tile_min = vec2(tile & 0xFFFFu, tile >> 16) * SCREEN_TILE_SIZE;
+    vec2 pixel = min(tile_min + (in_position.xy * 0.5 + 0.5) * SCREEN_TILE_SIZE, view_buffer.data.viewport.xy);
+    vec2 ndc = pixel * view_buffer.data.viewport.zw * 2.0 - 1.0;
+
+    gl_Position = vec4(ndc, float(material_buffer.data.index + 1) * MATERIAL_DEPTH_SCALE, 1.0);
+    out_screen_pos = ndc;
+}
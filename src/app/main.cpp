@@ -0,0 +1,341 @@
+#include "scene.h"
+#include "scene_importer.h"
+#include "camera.h"
+#include "camera_controller.h"
+#include "camera_path.h"
+#include "renderer.h"
+#include "readback.h"
+#include "image_io.h"
+#include "cpu_profiler.h"
+#include "cpu_rasterizer.h"
+#include "cpu_triangle_filtering.h"
+#include <core/path.h>
+#include <core/io/file_access.h>
+#include <input/input_events.h>
+#include <rhi/ez_vulkan.h>
+#include <rhi/rhi_shader_mgr.h>
+#if defined(_WIN32)
+#define GLFW_EXPOSE_NATIVE_WIN32
+#else
+#define GLFW_EXPOSE_NATIVE_X11
+#endif
+#include <GLFW/glfw3.h>
+#include <GLFW/glfw3native.h>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+struct AppOptions
+{
+    bool headless = false;
+    bool overlay = false;
+    bool cpu = false;
+    bool cpu_filtering = false;
+    bool temporal_reuse = true;
+    bool pipelined_filtering = false;
+    bool shadows = false;
+    // Random point and spot lights added to every scene
+    uint32_t light_count = 0;
+    uint32_t width = 1024;
+    uint32_t height = 768;
+    uint32_t frame_count = 1;
+    uint32_t cluster_size = CLUSTER_SIZE;
+    std::string scene = "scene://dragon/dragon.gltf";
+    std::string output;
+    std::string record_camera_path;
+    std::string trace_path;
+};
+
+static AppOptions parse_options(int argc, char** argv)
+{
+    AppOptions options;
+    for (int i = 1; i < argc; ++i)
+    {
+        bool has_value = i + 1 < argc;
+        if (strcmp(argv[i], "--headless") == 0)
+            options.headless = true;
+        else if (strcmp(argv[i], "--overlay") == 0)
+            options.overlay = true;
+        else if (strcmp(argv[i], "--cpu") == 0)
+            options.cpu = true;
+        else if (strcmp(argv[i], "--cpu-filtering") == 0)
+            options.cpu_filtering = true;
+        else if (strcmp(argv[i], "--no-temporal-reuse") == 0)
+            options.temporal_reuse = false;
+        else if (strcmp(argv[i], "--pipelined-filtering") == 0)
+            options.pipelined_filtering = true;
+        else if (strcmp(argv[i], "--shadows") == 0)
+            options.shadows = true;
+        else if (strcmp(argv[i], "--lights") == 0 && has_value)
+            options.light_count = (uint32_t)atoi(argv[++i]);
+        else if (strcmp(argv[i], "--width") == 0 && has_value)
+            options.width = (uint32_t)atoi(argv[++i]);
+        else if (strcmp(argv[i], "--height") == 0 && has_value)
+            options.height = (uint32_t)atoi(argv[++i]);
+        else if (strcmp(argv[i], "--frames") == 0 && has_value)
+            options.frame_count = (uint32_t)atoi(argv[++i]);
+        else if (strcmp(argv[i], "--scene") == 0 && has_value)
+            options.scene = argv[++i];
+        else if (strcmp(argv[i], "--cluster-size") == 0 && has_value)
+            options.cluster_size = (uint32_t)atoi(argv[++i]);
+        else if (strcmp(argv[i], "--output") == 0 && has_value)
+            options.output = argv[++i];
+        else if (strcmp(argv[i], "--record-camera") == 0 && has_value)
+            options.record_camera_path = argv[++i];
+        else if (strcmp(argv[i], "--trace") == 0 && has_value)
+            options.trace_path = argv[++i];
+    }
+    return options;
+}
+
+static void* get_native_window(GLFWwindow* window)
+{
+#if defined(_WIN32)
+    return glfwGetWin32Window(window);
+#else
+    return (void*)glfwGetX11Window(window);
+#endif
+}
+
+static void window_size_callback(GLFWwindow* window, int w, int h)
+{
+}
+
+static void cursor_position_callback(GLFWwindow* window, double pos_x, double pos_y)
+{
+    MouseEvent mouse_event;
+    mouse_event.type = MouseEvent::Type::MOVE;
+    mouse_event.x = (float)pos_x;
+    mouse_event.y = (float)pos_y;
+    Input::get_mouse_event().broadcast(mouse_event);
+}
+
+static void mouse_button_callback(GLFWwindow* window, int button, int action, int mods)
+{
+    double pos_x, pos_y;
+    glfwGetCursorPos(window, &pos_x, &pos_y);
+
+    if (action == 0)
+    {
+        MouseEvent mouse_event;
+        mouse_event.type = MouseEvent::Type::UP;
+        mouse_event.x = (float)pos_x;
+        mouse_event.y = (float)pos_y;
+        mouse_event.button = button;
+        Input::get_mouse_event().broadcast(mouse_event);
+    }
+    else if (action == 1)
+    {
+        MouseEvent mouse_event;
+        mouse_event.type = MouseEvent::Type::DOWN;
+        mouse_event.x = (float)pos_x;
+        mouse_event.y = (float)pos_y;
+        mouse_event.button = button;
+        Input::get_mouse_event().broadcast(mouse_event);
+    }
+}
+
+static void mouse_scroll_callback(GLFWwindow* window, double offset_x, double offset_y)
+{
+    MouseEvent mouse_event;
+    mouse_event.type = MouseEvent::Type::WHEEL;
+    mouse_event.offset_x = (float)offset_x;
+    mouse_event.offset_y = (float)offset_y;
+    Input::get_mouse_event().broadcast(mouse_event);
+}
+
+// There is no text rendering, the smoothed GPU pass durations are shown in the title bar
+static void update_overlay(GLFWwindow* window, Renderer* renderer)
+{
+    std::string title = "visibility-buffer";
+    double total_time = 0.0;
+    for (auto& pass_timing : renderer->get_gpu_pass_timings())
+    {
+        char text[128];
+        snprintf(text, sizeof(text), " | %s %.3fms", pass_timing.name.c_str(), pass_timing.gpu_time);
+        title += text;
+        total_time += pass_timing.gpu_time;
+    }
+    char text[64];
+    snprintf(text, sizeof(text), " | gpu %.3fms", total_time);
+    title += text;
+    glfwSetWindowTitle(window, title.c_str());
+}
+
+static void run_headless(const AppOptions& options, Renderer* renderer)
+{
+    EzTexture target = Renderer::create_offscreen_target(options.width, options.height);
+
+    for (uint32_t i = 0; i < options.frame_count; ++i)
+    {
+        PROFILE_SCOPE("frame");
+        renderer->render(target);
+
+        PROFILE_SCOPE("submit");
+        ez_submit();
+    }
+
+    if (!options.output.empty())
+    {
+        std::vector<uint8_t> pixels;
+        readback_texture(target, VK_IMAGE_ASPECT_COLOR_BIT, options.width, options.height, 4, pixels);
+        write_ppm(options.output, options.width, options.height, pixels);
+    }
+
+    ez_destroy_texture(target);
+}
+
+// Visibility buffer from the CPU rasterizer, in the same byte layout as a readback of vb_rt
+static void run_cpu(const AppOptions& options, Scene* scene, Camera* camera)
+{
+    CpuRasterizer rasterizer;
+    CpuTriangleFiltering triangle_filtering;
+    ClusterCullingResult culling_result;
+    for (uint32_t i = 0; i < options.frame_count; ++i)
+    {
+        // Same culling and filtering as the GPU path, so the ids are the ones it would write
+        cull_clusters(scene, camera->get_translation(), culling_result);
+        triangle_filtering.filter(scene, camera->get_proj_matrix() * camera->get_view_matrix(), culling_result);
+        rasterizer.render(scene, camera, triangle_filtering.get_filtered_indices(), triangle_filtering.get_draw_commands(), options.width, options.height);
+    }
+
+    if (!options.output.empty())
+    {
+        std::vector<uint8_t> pixels;
+        rasterizer.get_visibility_buffer_bgra(pixels);
+        write_ppm(options.output, options.width, options.height, pixels);
+    }
+}
+
+static void run_windowed(const AppOptions& options, Renderer* renderer, Camera* camera)
+{
+    glfwInit();
+    glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+    GLFWwindow* glfw_window = glfwCreateWindow(options.width, options.height, "visibility-buffer", nullptr, nullptr);
+    glfwSetFramebufferSizeCallback(glfw_window, window_size_callback);
+    glfwSetCursorPosCallback(glfw_window, cursor_position_callback);
+    glfwSetMouseButtonCallback(glfw_window, mouse_button_callback);
+    glfwSetScrollCallback(glfw_window, mouse_scroll_callback);
+    EzSwapchain swapchain = VK_NULL_HANDLE;
+    ez_create_swapchain(get_native_window(glfw_window), swapchain);
+
+    CameraController* camera_controller = new CameraController();
+    camera_controller->set_camera(camera);
+    CameraPath camera_path;
+    uint64_t frame_count = 0;
+
+    while (!glfwWindowShouldClose(glfw_window))
+    {
+        PROFILE_SCOPE("frame");
+        glfwPollEvents();
+
+        EzSwapchainStatus swapchain_status = ez_update_swapchain(swapchain);
+
+        if (swapchain_status == EzSwapchainStatus::NotReady)
+            continue;
+
+        if (swapchain_status == EzSwapchainStatus::Resized)
+        {
+            camera->set_aspect(swapchain->width/swapchain->height);
+        }
+
+        {
+            PROFILE_SCOPE("acquire_next_image");
+            ez_acquire_next_image(swapchain);
+        }
+
+        if (!options.record_camera_path.empty())
+            camera_path.record(camera);
+
+        {
+            PROFILE_SCOPE("render");
+            renderer->render(swapchain);
+        }
+
+        VkImageMemoryBarrier2 present_barrier[] = { ez_image_barrier(swapchain, EZ_RESOURCE_STATE_PRESENT) };
+        ez_pipeline_barrier(0, 0, nullptr, 1, present_barrier);
+
+        {
+            PROFILE_SCOPE("present");
+            ez_present(swapchain);
+        }
+
+        {
+            PROFILE_SCOPE("submit");
+            ez_submit();
+        }
+
+        if (options.overlay && (frame_count++ % 30) == 0)
+            update_overlay(glfw_window, renderer);
+    }
+
+    if (!options.record_camera_path.empty())
+        camera_path.save(options.record_camera_path);
+
+    delete camera_controller;
+
+    ez_destroy_swapchain(swapchain);
+    glfwDestroyWindow(glfw_window);
+    glfwTerminate();
+}
+
+int main(int argc, char** argv)
+{
+    AppOptions options = parse_options(argc, argv);
+    set_cpu_profiling_enabled(!options.trace_path.empty());
+
+    // Path settings
+    Path::register_protocol("content", std::string(PROJECT_DIR) + "/content/");
+    Path::register_protocol("scene", std::string(PROJECT_DIR) + "/content/scene/");
+    Path::register_protocol("shader", std::string(PROJECT_DIR) + "/content/shader/");
+
+    Camera* camera = new Camera();
+    camera->set_aspect(options.headless || options.cpu ? (float)options.width / (float)options.height : 800.0f/600.0f);
+    camera->set_translation(glm::vec3(1.28223431f, 13.497385f, -5.47421837f));
+    camera->set_euler(glm::vec3(-1.66900015f, -0.0499999598f, 0.0f));
+    Scene* scene = load_scene(options.scene, options.cluster_size);
+    if (!scene)
+    {
+        printf("failed to load %s with cluster size %u\n", options.scene.c_str(), options.cluster_size);
+        delete camera;
+        return 1;
+    }
+    add_random_lights(scene, options.light_count);
+
+    // The CPU path never touches Vulkan
+    if (options.cpu)
+    {
+        run_cpu(options, scene, camera);
+    }
+    else
+    {
+        ez_init();
+        rhi_shader_mgr_init();
+
+        Renderer* renderer = new Renderer();
+        renderer->set_scene(scene);
+        renderer->set_camera(camera);
+        renderer->set_cpu_triangle_filtering(options.cpu_filtering);
+        renderer->set_temporal_reuse(options.temporal_reuse);
+        renderer->set_pipelined_filtering(options.pipelined_filtering);
+        renderer->set_shadows(options.shadows);
+
+        if (options.headless)
+            run_headless(options, renderer);
+        else
+            run_windowed(options, renderer, camera);
+
+        delete renderer;
+
+        rhi_shader_mgr_terminate();
+        ez_flush();
+        ez_terminate();
+    }
+
+    delete scene;
+    delete camera;
+
+    if (!options.trace_path.empty())
+        write_cpu_trace(options.trace_path);
+    return 0;
+}
@@ -1,6 +1,7 @@
 #include "camera.h"
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtx/matrix_decompose.hpp>
+#include <cmath>
 
 Camera::Camera()
 {
@@ -13,9 +14,14 @@ glm::mat4 Camera::get_proj_matrix()
 {
     if (_proj_dirty)
     {
-        _proj_matrix = glm::perspective(_fov, _aspect, _near, _far);
+        // Reversed-Z with an infinite far plane: the near plane maps to 1 and infinity to 0
+        float focal_length = 1.0f / std::tan(_fov * 0.5f);
+        _proj_matrix = glm::mat4(0.0f);
+        _proj_matrix[0][0] = focal_length / _aspect;
         // reverse y axis
-        _proj_matrix[1][1] *= -1;
+        _proj_matrix[1][1] = -focal_length;
+        _proj_matrix[2][3] = -1.0f;
+        _proj_matrix[3][2] = _near;
         _proj_dirty = false;
     }
     return _proj_matrix;
@@ -49,37 +55,55 @@ void Camera::_update_transform()
 
 void Camera::set_fov(float fov)
 {
+    if (fov == _fov)
+        return;
     _fov = fov;
+    _version++;
     _proj_dirty = true;
 }
 
 void Camera::set_near_far(float near, float far)
 {
+    if (near == _near && far == _far)
+        return;
     _near = near;
     _far = far;
+    _version++;
     _proj_dirty = true;
 }
 
 void Camera::set_aspect(float aspect)
 {
+    if (aspect == _aspect)
+        return;
     _aspect = aspect;
+    _version++;
     _proj_dirty = true;
 }
 
 void Camera::set_translation(const glm::vec3& translation)
 {
+    if (translation == _translation)
+        return;
     _translation = translation;
+    _version++;
     _transform_dirty = true;
 }
 
 void Camera::set_scale(const glm::vec3& scale)
 {
+    if (scale == _scale)
+        return;
     _scale = scale;
+    _version++;
     _transform_dirty = true;
 }
 
 void Camera::set_euler(const glm::vec3& euler)
 {
+    if (euler == _euler)
+        return;
     _euler = euler;
+    _version++;
     _transform_dirty = true;
 }
\ No newline at end of file
@@ -7,6 +7,7 @@ class Camera
 public:
     Camera();
 
+    // Reversed-Z with an infinite far plane, depth is 1 at the near plane and 0 at infinity
     glm::mat4 get_proj_matrix();
 
     glm::mat4 get_view_matrix();
@@ -15,6 +16,7 @@ public:
 
     void set_fov(float fov);
 
+    // The far distance does not affect the projection, it is kept for callers that need a finite range
     void set_near_far(float near, float far);
 
     float get_near() const { return _near; }
@@ -35,11 +37,15 @@ public:
 
     glm::vec3 get_euler() { return _euler; }
 
+    // Bumped by every setter that changes a value, lets the renderer detect a static view
+    uint64_t get_version() const { return _version; }
+
 private:
     void _update_transform();
 
     bool _proj_dirty = true;
     bool _transform_dirty = true;
+    uint64_t _version = 0;
     float _fov = 45.0f;
     float _near = 0.1f;
     float _far = 100.0f;
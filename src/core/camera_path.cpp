@@ -0,0 +1,83 @@
+#include "camera_path.h"
+#include "camera.h"
+#include <glm/gtc/constants.hpp>
+#include <fstream>
+
+CameraPath CameraPath::create_orbit(const BoundingBox& bounds, uint32_t keyframe_count)
+{
+    CameraPath path;
+    glm::vec3 center = bounds.get_center();
+    float radius = glm::length(bounds.get_size()) * 0.75f;
+    float height = bounds.get_size().y * 0.25f;
+    for (uint32_t i = 0; i <= keyframe_count; ++i)
+    {
+        // Yaw keeps growing past 2 PI so interpolation never wraps backwards
+        float angle = glm::two_pi<float>() * (float)i / (float)keyframe_count;
+        glm::vec3 translation = center + glm::vec3(glm::sin(angle) * radius, height, glm::cos(angle) * radius);
+        glm::vec3 direction = glm::normalize(center - translation);
+
+        CameraKeyframe keyframe{};
+        keyframe.translation = translation;
+        keyframe.euler = glm::vec3(glm::asin(direction.y), angle, 0.0f);
+        path.add_keyframe(keyframe);
+    }
+    return path;
+}
+
+bool CameraPath::load(const std::string& file_path)
+{
+    std::ifstream file(file_path);
+    if (!file.is_open())
+        return false;
+
+    _keyframes.clear();
+    CameraKeyframe keyframe{};
+    while (file >> keyframe.translation.x >> keyframe.translation.y >> keyframe.translation.z >> keyframe.euler.x >> keyframe.euler.y >> keyframe.euler.z)
+    {
+        _keyframes.push_back(keyframe);
+    }
+    return !_keyframes.empty();
+}
+
+bool CameraPath::save(const std::string& file_path) const
+{
+    std::ofstream file(file_path);
+    if (!file.is_open())
+        return false;
+
+    for (auto& keyframe : _keyframes)
+    {
+        file << keyframe.translation.x << " " << keyframe.translation.y << " " << keyframe.translation.z << " "
+             << keyframe.euler.x << " " << keyframe.euler.y << " " << keyframe.euler.z << "\n";
+    }
+    return file.good();
+}
+
+void CameraPath::add_keyframe(const CameraKeyframe& keyframe)
+{
+    _keyframes.push_back(keyframe);
+}
+
+void CameraPath::record(Camera* camera)
+{
+    CameraKeyframe keyframe{};
+    keyframe.translation = camera->get_translation();
+    keyframe.euler = camera->get_euler();
+    _keyframes.push_back(keyframe);
+}
+
+void CameraPath::apply(Camera* camera, float t) const
+{
+    if (_keyframes.empty())
+        return;
+
+    float position = glm::clamp(t, 0.0f, 1.0f) * (float)(_keyframes.size() - 1);
+    size_t index = glm::min((size_t)position, _keyframes.size() - 1);
+    size_t next_index = glm::min(index + 1, _keyframes.size() - 1);
+    float alpha = position - (float)index;
+
+    const CameraKeyframe& a = _keyframes[index];
+    const CameraKeyframe& b = _keyframes[next_index];
+    camera->set_translation(glm::mix(a.translation, b.translation, alpha));
+    camera->set_euler(glm::mix(a.euler, b.euler, alpha));
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <math/bounding_box.h>
+#include <string>
+#include <vector>
+
+class Camera;
+
+struct CameraKeyframe
+{
+    glm::vec3 translation;
+    glm::vec3 euler;
+};
+
+// Recorded or scripted camera motion, replayed deterministically by frame index
+class CameraPath
+{
+public:
+    static CameraPath create_orbit(const BoundingBox& bounds, uint32_t keyframe_count);
+
+    bool load(const std::string& file_path);
+
+    bool save(const std::string& file_path) const;
+
+    void add_keyframe(const CameraKeyframe& keyframe);
+
+    void record(Camera* camera);
+
+    // t in [0, 1] over the whole path
+    void apply(Camera* camera, float t) const;
+
+    bool empty() const { return _keyframes.empty(); }
+
+private:
+    std::vector<CameraKeyframe> _keyframes;
+};
@@ -0,0 +1,404 @@
+#include "cluster_culling.h"
+#include "scene.h"
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <numeric>
+
+// Distance from the camera to the closest point of the cluster bounds, 0 inside
+static float get_cluster_distance(const Cluster& cluster, const glm::vec3& camera_position)
+{
+    glm::vec3 closest = glm::clamp(camera_position, cluster.aabb_min, cluster.aabb_max);
+    return glm::length(closest - camera_position);
+}
+
+// LSD radix sort on a 16 bit key, two passes of 8 bits. It is stable, so clusters that quantize
+// to the same distance keep the order of the previous frame
+static void radix_sort(const std::vector<uint16_t>& keys, std::vector<uint32_t>& order, std::vector<uint32_t>& scratch)
+{
+    scratch.resize(order.size());
+    for (uint32_t shift = 0; shift < 16; shift += 8)
+    {
+        uint32_t offsets[256] = {};
+        for (auto index : order)
+        {
+            offsets[(keys[index] >> shift) & 0xFF]++;
+        }
+        uint32_t sum = 0;
+        for (uint32_t i = 0; i < 256; ++i)
+        {
+            uint32_t count = offsets[i];
+            offsets[i] = sum;
+            sum += count;
+        }
+        for (auto index : order)
+        {
+            scratch[offsets[(keys[index] >> shift) & 0xFF]++] = index;
+        }
+        order.swap(scratch);
+    }
+}
+
+static void sort_clusters(Mesh* mesh, const glm::vec3& camera_position, std::vector<uint32_t>& order, ClusterCullingResult& result)
+{
+    uint32_t cluster_count = (uint32_t)mesh->clusters.size();
+    if (order.size() != cluster_count)
+    {
+        order.resize(cluster_count);
+        std::iota(order.begin(), order.end(), 0u);
+    }
+
+    float max_distance = 0.0f;
+    for (auto& cluster : mesh->clusters)
+    {
+        cluster.distance_from_camera = get_cluster_distance(cluster, camera_position);
+        max_distance = glm::max(max_distance, cluster.distance_from_camera);
+    }
+
+    // Quantized over the distance range of the mesh, approximate order is all early-Z needs
+    float scale = max_distance > 0.0f ? 65535.0f / max_distance : 0.0f;
+    result.sort_keys.resize(cluster_count);
+    for (uint32_t i = 0; i < cluster_count; ++i)
+    {
+        result.sort_keys[i] = (uint16_t)(mesh->clusters[i].distance_from_camera * scale);
+    }
+    radix_sort(result.sort_keys, order, result.sort_scratch);
+}
+
+static bool is_cluster_culled(const Cluster& cluster, const glm::vec3& camera_position)
+{
+    if (!cluster.valid)
+        return false;
+    glm::vec3 test_vec = glm::normalize(camera_position - cluster.cone_center);
+    return glm::dot(test_vec, cluster.cone_axis) < cluster.cone_angle_cosine;
+}
+
+// Same test as is_cluster_culled, also returns the distance the camera can move without changing the result
+static bool test_cluster(const Cluster& cluster, const glm::vec3& camera_position, float& radius)
+{
+    radius = std::numeric_limits<float>::infinity();
+    if (!cluster.valid)
+        return false;
+
+    glm::vec3 offset = camera_position - cluster.cone_center;
+    float distance = glm::length(offset);
+    if (distance <= 0.0f)
+    {
+        radius = 0.0f;
+        return false;
+    }
+
+    // Clusters with a degenerate cone never pass the comparison, their result can not change
+    float cos_angle = glm::dot(offset, cluster.cone_axis) / distance;
+    if (std::isnan(cos_angle) || std::isnan(cluster.cone_angle_cosine))
+        return false;
+    bool culled = cos_angle < cluster.cone_angle_cosine;
+
+    // Angle to the cone surface seen from the apex, past 90 degrees the apex is the closest point
+    float angle = std::acos(glm::clamp(cos_angle, -1.0f, 1.0f));
+    float cone_angle = std::acos(glm::clamp(cluster.cone_angle_cosine, -1.0f, 1.0f));
+    float delta = glm::min(std::abs(angle - cone_angle), 1.5707963f);
+    // Shrunk a little so rounding can never keep a stale result
+    radius = distance * std::sin(delta) * 0.99f;
+    if (std::isnan(radius))
+        radius = 0.0f;
+    return culled;
+}
+
+static void push_expiry(ClusterVisibilityCache& cache, uint32_t cluster_index, float radius)
+{
+    if (radius == std::numeric_limits<float>::infinity())
+        return;
+    cache.expiry_heap.emplace_back(cache.camera_travel + radius, cluster_index);
+    std::push_heap(cache.expiry_heap.begin(), cache.expiry_heap.end(), std::greater<std::pair<double, uint32_t>>());
+}
+
+static void update_visibility_cache(Scene* scene, const glm::vec3& camera_position, ClusterCullingResult& result)
+{
+    ClusterVisibilityCache& cache = result.visibility_cache;
+    std::vector<Mesh>& meshs = scene->meshs;
+
+    uint32_t cluster_count = 0;
+    for (auto& mesh : meshs)
+    {
+        cluster_count += (uint32_t)mesh.clusters.size();
+    }
+
+    bool rebuild = cache.scene != scene || cache.scene_version != scene->version || cache.culled.size() != cluster_count;
+    if (rebuild)
+    {
+        cache.scene = scene;
+        cache.scene_version = scene->version;
+        cache.mesh_offsets.resize(meshs.size());
+        cache.culled.resize(cluster_count);
+        cache.expiry_heap.clear();
+        cache.camera_position = camera_position;
+        cache.camera_travel = 0.0;
+
+        uint32_t offset = 0;
+        for (uint32_t i = 0; i < meshs.size(); ++i)
+        {
+            cache.mesh_offsets[i] = offset;
+            for (uint32_t j = 0; j < meshs[i].clusters.size(); ++j)
+            {
+                float radius;
+                cache.culled[offset + j] = test_cluster(meshs[i].clusters[j], camera_position, radius);
+                push_expiry(cache, offset + j, radius);
+            }
+            offset += (uint32_t)meshs[i].clusters.size();
+        }
+        result.stats.tested_cluster_count = cluster_count;
+        return;
+    }
+
+    cache.camera_travel += glm::length(camera_position - cache.camera_position);
+    cache.camera_position = camera_position;
+
+    std::vector<std::pair<double, uint32_t>>& heap = cache.expiry_heap;
+    auto compare = std::greater<std::pair<double, uint32_t>>();
+    std::vector<uint32_t> expired;
+    while (!heap.empty() && heap.front().first <= cache.camera_travel)
+    {
+        expired.push_back(heap.front().second);
+        std::pop_heap(heap.begin(), heap.end(), compare);
+        heap.pop_back();
+    }
+
+    for (auto cluster_index : expired)
+    {
+        uint32_t mesh_index = (uint32_t)(std::upper_bound(cache.mesh_offsets.begin(), cache.mesh_offsets.end(), cluster_index) - cache.mesh_offsets.begin()) - 1;
+        const Cluster& cluster = meshs[mesh_index].clusters[cluster_index - cache.mesh_offsets[mesh_index]];
+        float radius;
+        cache.culled[cluster_index] = test_cluster(cluster, camera_position, radius);
+        push_expiry(cache, cluster_index, radius);
+    }
+    result.stats.tested_cluster_count = (uint32_t)expired.size();
+}
+
+// Packs the visible clusters into batches, a draw ends with its mesh or when a chunk is full
+struct BatchBuilder
+{
+    std::vector<SmallBatchData>& batches;
+    int accum_draw_count = 0;
+    int accum_num_triangles = 0;
+    int accum_num_triangles_at_start_of_batch = 0;
+    int batch_start = 0;
+    uint32_t current_batch_count = 0;
+
+    BatchBuilder(std::vector<SmallBatchData>& batches) : batches(batches) {}
+
+    void add_cluster(uint32_t mesh_index, const ClusterCompact& compact, uint32_t view_index)
+    {
+        SmallBatchData batch_data;
+        batch_data.accum_draw_index = accum_draw_count;
+        batch_data.face_count = compact.triangle_count;
+        batch_data.mesh_index = mesh_index;
+        batch_data.index_offset = compact.cluster_start * 3;
+        batch_data.output_index_offset = accum_num_triangles_at_start_of_batch * 3;
+        batch_data.draw_batch_start = batch_start;
+        batch_data.view_index = view_index;
+        batches.push_back(batch_data);
+
+        current_batch_count++;
+        accum_num_triangles += compact.triangle_count;
+    }
+
+    void end_cluster()
+    {
+        // Chunk is full, the next batches go to a new dispatch and a new draw
+        if (current_batch_count >= BATCH_COUNT)
+        {
+            accum_draw_count++;
+
+            current_batch_count = 0;
+            batch_start = 0;
+            accum_num_triangles_at_start_of_batch = accum_num_triangles;
+        }
+    }
+
+    void end_mesh()
+    {
+        if (current_batch_count > 0)
+        {
+            accum_draw_count++;
+            batch_start = current_batch_count;
+            accum_num_triangles_at_start_of_batch = accum_num_triangles;
+        }
+    }
+};
+
+void cull_clusters(Scene* scene, const glm::vec3& camera_position, ClusterCullingResult& result, bool front_to_back, bool incremental)
+{
+    result.batches.clear();
+    result.stats = {};
+    result.dropped_cluster_count = 0;
+
+    BatchBuilder builder(result.batches);
+
+    if (front_to_back)
+        result.cluster_orders.resize(scene->meshs.size());
+
+    if (incremental)
+        update_visibility_cache(scene, camera_position, result);
+
+    for (int i = 0; i < scene->meshs.size(); ++i)
+    {
+        Mesh* mesh = &scene->meshs[i];
+        if (front_to_back)
+            sort_clusters(mesh, camera_position, result.cluster_orders[i], result);
+
+        for (int k = 0; k < mesh->clusters.size(); ++k)
+        {
+            int j = front_to_back ? (int)result.cluster_orders[i][k] : k;
+            const Cluster* cluster = &mesh->clusters[j];
+            const ClusterCompact* compact = &mesh->compacts[j];
+
+            bool cull_cluster;
+            if (incremental)
+            {
+                cull_cluster = result.visibility_cache.culled[result.visibility_cache.mesh_offsets[i] + j] != 0;
+            }
+            else
+            {
+                cull_cluster = is_cluster_culled(*cluster, camera_position);
+                result.stats.tested_cluster_count++;
+            }
+
+            result.stats.cluster_count++;
+            result.stats.triangle_count += compact->triangle_count;
+            // Batch compaction handles MAX_DRAW_CMD_COUNT - 1 draws, the clusters of later draws are left out
+            if (!cull_cluster && builder.accum_draw_count >= MAX_DRAW_CMD_COUNT - 1)
+            {
+                result.dropped_cluster_count++;
+            }
+            else if (!cull_cluster)
+            {
+                result.stats.visible_cluster_count++;
+                result.stats.visible_triangle_count += compact->triangle_count;
+                builder.add_cluster(i, *compact, 0);
+            }
+            builder.end_cluster();
+        }
+        builder.end_mesh();
+    }
+
+    result.draw_count = glm::min((uint32_t)builder.accum_draw_count, (uint32_t)MAX_DRAW_CMD_COUNT - 1);
+}
+
+// Every corner outside the same clip plane. Visible depth is [0, w] for the reversed-Z perspective
+// as well as for orthographic light projections.
+static bool is_aabb_outside(const glm::mat4& m, const glm::vec3& aabb_min, const glm::vec3& aabb_max)
+{
+    uint32_t outcode = 0x3F;
+    for (uint32_t i = 0; i < 8; ++i)
+    {
+        glm::vec3 corner = glm::vec3((i & 1) ? aabb_max.x : aabb_min.x, (i & 2) ? aabb_max.y : aabb_min.y, (i & 4) ? aabb_max.z : aabb_min.z);
+        glm::vec4 clip = m * glm::vec4(corner, 1.0f);
+        uint32_t corner_outcode = 0;
+        corner_outcode |= clip.x > clip.w ? 0x01 : 0;
+        corner_outcode |= clip.y > clip.w ? 0x02 : 0;
+        corner_outcode |= clip.z > clip.w ? 0x04 : 0;
+        corner_outcode |= clip.x < -clip.w ? 0x08 : 0;
+        corner_outcode |= clip.y < -clip.w ? 0x10 : 0;
+        corner_outcode |= clip.z < 0.0f ? 0x20 : 0;
+        outcode &= corner_outcode;
+        if (outcode == 0)
+            return false;
+    }
+    return true;
+}
+
+static bool is_cluster_visible(const Cluster& cluster, const CullingView& view)
+{
+    if (is_aabb_outside(view.view_proj_matrix, cluster.aabb_min, cluster.aabb_max))
+        return false;
+    if (!view.orthographic)
+        return !is_cluster_culled(cluster, view.position);
+    // Seen from infinitely far away, the direction to the viewer is the same for every cluster
+    if (!cluster.valid)
+        return true;
+    return glm::dot(-view.direction, cluster.cone_axis) >= cluster.cone_angle_cosine;
+}
+
+void cull_clusters_multi_view(Scene* scene, const std::vector<CullingView>& views, MultiViewCullingResult& result)
+{
+    result.batches.clear();
+    result.views.clear();
+    result.view_masks.clear();
+    result.dropped_view_count = 0;
+    uint32_t view_count = glm::min((uint32_t)views.size(), (uint32_t)MAX_CULLING_VIEWS);
+
+    for (auto& mesh : scene->meshs)
+    {
+        for (auto& cluster : mesh.clusters)
+        {
+            uint8_t view_mask = 0;
+            for (uint32_t v = 0; v < view_count; ++v)
+            {
+                if (is_cluster_visible(cluster, views[v]))
+                    view_mask |= (uint8_t)(1 << v);
+            }
+            result.view_masks.push_back(view_mask);
+        }
+    }
+
+    // Only the masks are read from here on, the cluster data is not touched again
+    BatchBuilder builder(result.batches);
+    for (uint32_t v = 0; v < view_count; ++v)
+    {
+        ViewCullingRange range{};
+        range.first_draw = builder.accum_draw_count;
+        range.first_index = builder.accum_num_triangles * 3;
+        if (result.dropped_view_count > 0)
+        {
+            result.dropped_view_count++;
+            result.views.push_back(range);
+            continue;
+        }
+
+        // Restored when the view does not fit
+        size_t first_batch = result.batches.size();
+        BatchBuilder view_start = builder;
+
+        uint32_t cluster_index = 0;
+        for (uint32_t i = 0; i < scene->meshs.size(); ++i)
+        {
+            Mesh& mesh = scene->meshs[i];
+            for (uint32_t j = 0; j < mesh.clusters.size(); ++j)
+            {
+                const ClusterCompact& compact = mesh.compacts[j];
+                range.stats.cluster_count++;
+                range.stats.tested_cluster_count++;
+                range.stats.triangle_count += compact.triangle_count;
+                if (result.view_masks[cluster_index++] & (1 << v))
+                {
+                    range.stats.visible_cluster_count++;
+                    range.stats.visible_triangle_count += compact.triangle_count;
+                    builder.add_cluster(i, compact, v);
+                }
+                builder.end_cluster();
+            }
+            builder.end_mesh();
+        }
+
+        if (builder.accum_draw_count > MAX_DRAW_CMD_COUNT)
+        {
+            result.batches.resize(first_batch);
+            builder.accum_draw_count = view_start.accum_draw_count;
+            builder.accum_num_triangles = view_start.accum_num_triangles;
+            builder.accum_num_triangles_at_start_of_batch = view_start.accum_num_triangles_at_start_of_batch;
+            builder.batch_start = view_start.batch_start;
+            builder.current_batch_count = view_start.current_batch_count;
+            result.dropped_view_count++;
+            result.views.push_back(ViewCullingRange{range.first_draw, 0, range.first_index, 0, {}});
+            continue;
+        }
+
+        range.draw_count = builder.accum_draw_count - range.first_draw;
+        range.index_count = builder.accum_num_triangles * 3 - range.first_index;
+        result.views.push_back(range);
+    }
+
+    result.draw_count = builder.accum_draw_count;
+}
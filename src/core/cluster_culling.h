@@ -0,0 +1,137 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#define BATCH_COUNT 512
+#define MAX_DRAW_CMD_COUNT 256
+// Views of one cull_clusters_multi_view call, one bit each in the cluster view masks
+#define MAX_CULLING_VIEWS 8
+
+class Scene;
+
+struct SmallBatchData
+{
+    uint32_t mesh_index;
+    uint32_t index_offset;
+    uint32_t face_count;
+    uint32_t output_index_offset;
+    uint32_t draw_batch_start;
+    uint32_t accum_draw_index;
+    // Selects the view matrix the triangles of the batch are filtered with
+    uint32_t view_index;
+};
+
+struct UncompactedDrawCommand
+{
+    uint32_t num_indices;
+    uint32_t start_index;
+    uint32_t mesh_index;
+};
+
+// Keep in sync with DrawCounter in shader_defs.glsl
+struct DrawCounter
+{
+    uint32_t count;
+    uint32_t batch_count;
+    uint32_t input_triangle_count;
+    uint32_t output_triangle_count;
+};
+
+struct TriangleFilteringStats
+{
+    uint32_t cluster_count;
+    uint32_t visible_cluster_count;
+    uint32_t triangle_count;
+    uint32_t visible_triangle_count;
+    // Clusters whose cone test ran this frame, the others reused their cached result
+    uint32_t tested_cluster_count;
+};
+
+// Cone test results kept across frames. Every cluster stores how far the camera can move before its
+// result may flip, the distance from the camera to the cone surface at the last test. The total camera
+// travel bounds the distance to any earlier position, so a cluster is retested once the travel since
+// its test exceeds that radius. A min heap on the expiry travel finds those clusters without a scan.
+struct ClusterVisibilityCache
+{
+    const Scene* scene = nullptr;
+    uint64_t scene_version = 0;
+    // Flattened over the meshes, mesh i starts at mesh_offsets[i]
+    std::vector<uint32_t> mesh_offsets;
+    std::vector<uint8_t> culled;
+    std::vector<std::pair<double, uint32_t>> expiry_heap;
+    glm::vec3 camera_position = glm::vec3(0.0f);
+    double camera_travel = 0.0;
+};
+
+struct ClusterCullingResult
+{
+    // Same layout as the GPU batch buffer, chunk k starts at k * BATCH_COUNT and only the last chunk can be partial.
+    // draw_batch_start is relative to the chunk, every chunk is one dispatch.
+    std::vector<SmallBatchData> batches;
+    uint32_t draw_count = 0;
+    TriangleFilteringStats stats{};
+    // Visible clusters left out because their draw did not fit in MAX_DRAW_CMD_COUNT - 1, not counted as visible
+    uint32_t dropped_cluster_count = 0;
+    // Front to back cluster order of every mesh, kept across frames to seed the next sort
+    std::vector<std::vector<uint32_t>> cluster_orders;
+    std::vector<uint16_t> sort_keys;
+    std::vector<uint32_t> sort_scratch;
+    ClusterVisibilityCache visibility_cache;
+
+    uint32_t get_chunk_count() const { return ((uint32_t)batches.size() + BATCH_COUNT - 1) / BATCH_COUNT; }
+
+    uint32_t get_chunk_batch_count(uint32_t chunk) const { return glm::min((uint32_t)batches.size() - chunk * BATCH_COUNT, (uint32_t)BATCH_COUNT); }
+};
+
+// A view of cull_clusters_multi_view. Perspective views test the cluster cones from their position,
+// orthographic ones, e.g. the cascades of a directional light, along their direction.
+struct CullingView
+{
+    glm::mat4 view_proj_matrix = glm::mat4(1.0f);
+    glm::vec3 position = glm::vec3(0.0f);
+    glm::vec3 direction = glm::vec3(0.0f, 0.0f, -1.0f);
+    bool orthographic = false;
+};
+
+struct ViewCullingRange
+{
+    uint32_t first_draw;
+    uint32_t draw_count;
+    // Reserved range of the filtered index buffer, packed by the visible cluster triangles
+    uint32_t first_index;
+    uint32_t index_count;
+    TriangleFilteringStats stats;
+};
+
+struct MultiViewCullingResult
+{
+    // Same chunk layout as ClusterCullingResult, the views follow each other and every view starts a new draw
+    std::vector<SmallBatchData> batches;
+    uint32_t draw_count = 0;
+    std::vector<ViewCullingRange> views;
+    // Trailing views whose draws did not fit in MAX_DRAW_CMD_COUNT next to the earlier ones, their ranges are empty
+    uint32_t dropped_view_count = 0;
+    // One bit per view for every cluster, flattened over the meshes
+    std::vector<uint8_t> view_masks;
+
+    uint32_t get_chunk_count() const { return ((uint32_t)batches.size() + BATCH_COUNT - 1) / BATCH_COUNT; }
+
+    uint32_t get_chunk_batch_count(uint32_t chunk) const { return glm::min((uint32_t)batches.size() - chunk * BATCH_COUNT, (uint32_t)BATCH_COUNT); }
+};
+
+// Cluster cone culling and batch building, shared by the GPU filtering pass and its CPU port.
+// With front_to_back the visible clusters of each mesh are emitted nearest first so the visibility
+// buffer pass gets more early depth rejection, meshes keep their order since it defines the draws.
+// With incremental only the clusters the camera may have changed the result of are tested again.
+// Batch compaction takes MAX_DRAW_CMD_COUNT - 1 draws, the visible clusters of later draws are dropped.
+void cull_clusters(Scene* scene, const glm::vec3& camera_position, ClusterCullingResult& result, bool front_to_back = true, bool incremental = true);
+
+// Culls the clusters for up to MAX_CULLING_VIEWS views in one traversal, a cone and a frustum test per view
+// builds each cluster's view mask. Batches are then emitted view after view with their own draws and
+// filtered index range. Meant for secondary views such as shadow cascades, there is no front to back
+// order or incremental cache. The draws of all views share one indirect buffer, a view that would
+// take them past MAX_DRAW_CMD_COUNT is dropped along with the views after it.
+void cull_clusters_multi_view(Scene* scene, const std::vector<CullingView>& views, MultiViewCullingResult& result);
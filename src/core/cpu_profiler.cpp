@@ -0,0 +1,106 @@
+#include "cpu_profiler.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+struct CpuProfileEvent
+{
+    const char* name;
+    // Nanoseconds
+    uint64_t start_time;
+    uint64_t duration;
+};
+
+struct CpuProfileThreadBuffer
+{
+    uint32_t thread_id;
+    std::vector<CpuProfileEvent> events;
+};
+
+static std::atomic<bool> g_cpu_profiling_enabled{false};
+static std::mutex g_thread_buffers_mutex;
+// Owned here rather than by the thread, worker threads may exit before the trace is written
+static std::vector<std::unique_ptr<CpuProfileThreadBuffer>> g_thread_buffers;
+
+static CpuProfileThreadBuffer* get_thread_buffer()
+{
+    thread_local CpuProfileThreadBuffer* thread_buffer = nullptr;
+    if (!thread_buffer)
+    {
+        std::lock_guard<std::mutex> lock(g_thread_buffers_mutex);
+        g_thread_buffers.push_back(std::make_unique<CpuProfileThreadBuffer>());
+        thread_buffer = g_thread_buffers.back().get();
+        thread_buffer->thread_id = (uint32_t)g_thread_buffers.size() - 1;
+        thread_buffer->events.reserve(4096);
+    }
+    return thread_buffer;
+}
+
+static uint64_t get_time()
+{
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+CpuProfileScope::CpuProfileScope(const char* name)
+{
+    _name = g_cpu_profiling_enabled.load(std::memory_order_relaxed) ? name : nullptr;
+    _start_time = _name ? get_time() : 0;
+}
+
+CpuProfileScope::~CpuProfileScope()
+{
+    if (!_name)
+        return;
+
+    uint64_t end_time = get_time();
+    get_thread_buffer()->events.push_back({_name, _start_time, end_time - _start_time});
+}
+
+void set_cpu_profiling_enabled(bool enable)
+{
+    g_cpu_profiling_enabled.store(enable, std::memory_order_relaxed);
+}
+
+bool is_cpu_profiling_enabled()
+{
+    return g_cpu_profiling_enabled.load(std::memory_order_relaxed);
+}
+
+bool write_cpu_trace(const std::string& path)
+{
+    std::ofstream file(path);
+    if (!file)
+        return false;
+
+    std::lock_guard<std::mutex> lock(g_thread_buffers_mutex);
+
+    uint64_t base_time = UINT64_MAX;
+    for (auto& thread_buffer : g_thread_buffers)
+    {
+        for (auto& event : thread_buffer->events)
+        {
+            base_time = std::min(base_time, event.start_time);
+        }
+    }
+
+    // Timestamps in microseconds
+    file << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+    bool first = true;
+    for (auto& thread_buffer : g_thread_buffers)
+    {
+        for (auto& event : thread_buffer->events)
+        {
+            file << (first ? "" : ",\n")
+                 << "{\"name\": \"" << event.name << "\", \"ph\": \"X\", \"pid\": 0, \"tid\": " << thread_buffer->thread_id
+                 << ", \"ts\": " << (double)(event.start_time - base_time) / 1000.0
+                 << ", \"dur\": " << (double)event.duration / 1000.0 << "}";
+            first = false;
+        }
+    }
+    file << "\n]}\n";
+    return true;
+}
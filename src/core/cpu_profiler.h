@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// Scoped CPU timing markers. Every thread records into its own buffer, the only lock is taken
+// the first time a thread records an event. Nothing is recorded unless profiling is enabled.
+class CpuProfileScope
+{
+public:
+    // The name must outlive the profiler, string literals only
+    CpuProfileScope(const char* name);
+
+    ~CpuProfileScope();
+
+private:
+    const char* _name;
+    uint64_t _start_time;
+};
+
+#define PROFILE_CONCAT_IMPL(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_IMPL(a, b)
+#define PROFILE_SCOPE(name) CpuProfileScope PROFILE_CONCAT(_profile_scope_, __LINE__)(name)
+
+void set_cpu_profiling_enabled(bool enable);
+
+bool is_cpu_profiling_enabled();
+
+// Chrome trace event format, loads in chrome://tracing and Perfetto.
+// Not synchronized with recording threads, call it once they are idle.
+bool write_cpu_trace(const std::string& path);
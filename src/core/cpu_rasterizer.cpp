@@ -0,0 +1,325 @@
+#include "cpu_rasterizer.h"
+#include "scene.h"
+#include "camera.h"
+#include "cpu_profiler.h"
+#include "parallel.h"
+#include <algorithm>
+#include <cmath>
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define CPU_RASTER_SSE2
+#endif
+
+static uint32_t calculate_output_id(uint32_t draw_id, uint32_t primitive_id)
+{
+    return ((draw_id << 23) & 0x7F800000) | (primitive_id & 0x007FFFFF);
+}
+
+// Sutherland-Hodgman against the near plane, reversed-Z so the near plane is z = w
+static uint32_t clip_near_plane(const glm::vec4 in_positions[3], glm::vec4 out_positions[4])
+{
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < 3; ++i)
+    {
+        const glm::vec4& a = in_positions[i];
+        const glm::vec4& b = in_positions[(i + 1) % 3];
+        float distance_a = a.w - a.z;
+        float distance_b = b.w - b.z;
+        if (distance_a >= 0.0f)
+            out_positions[count++] = a;
+        if ((distance_a >= 0.0f) != (distance_b >= 0.0f))
+            out_positions[count++] = glm::mix(a, b, distance_a / (distance_a - distance_b));
+    }
+    return count;
+}
+
+CpuRasterizer::CpuRasterizer(uint32_t thread_count)
+{
+    _thread_count = get_worker_thread_count(thread_count);
+    _triangle_bins.resize(_thread_count);
+}
+
+void CpuRasterizer::render(Scene* scene, Camera* camera, const std::vector<uint32_t>& indices, const std::vector<DrawCommand>& draw_commands,
+                           uint32_t width, uint32_t height)
+{
+    PROFILE_SCOPE("cpu_rasterizer");
+
+    _width = width;
+    _height = height;
+    _tile_count_x = (width + CPU_RASTER_TILE_SIZE - 1) / CPU_RASTER_TILE_SIZE;
+    _tile_count_y = (height + CPU_RASTER_TILE_SIZE - 1) / CPU_RASTER_TILE_SIZE;
+    _visibility_buffer.assign(width * height, CPU_RASTER_CLEAR_ID);
+    _depth_buffer.assign(width * height, 0.0f);
+
+    // Transform
+    glm::mat4 view_proj_matrix = camera->get_proj_matrix() * camera->get_view_matrix();
+    uint32_t vertex_count = (uint32_t)(scene->positions.size() / 3);
+    _clip_positions.resize(vertex_count);
+    uint32_t vertex_chunk_size = (vertex_count + _thread_count - 1) / _thread_count;
+    parallel_for(_thread_count, _thread_count, [&](uint32_t task) {
+        uint32_t begin = std::min(vertex_count, task * vertex_chunk_size);
+        uint32_t end = std::min(vertex_count, begin + vertex_chunk_size);
+        for (uint32_t i = begin; i < end; ++i)
+        {
+            const float* position = &scene->positions[i * 3];
+            _clip_positions[i] = view_proj_matrix * glm::vec4(position[0], position[1], position[2], 1.0f);
+        }
+    });
+
+    // Setup and binning, one contiguous triangle range per task
+    _draw_first_triangles.clear();
+    uint32_t triangle_count = 0;
+    for (auto& draw_command : draw_commands)
+    {
+        _draw_first_triangles.push_back(triangle_count);
+        triangle_count += draw_command.index_count / 3;
+    }
+    uint32_t triangle_chunk_size = (triangle_count + _thread_count - 1) / _thread_count;
+    parallel_for(_thread_count, _thread_count, [&](uint32_t task) {
+        uint32_t begin = std::min(triangle_count, task * triangle_chunk_size);
+        uint32_t end = std::min(triangle_count, begin + triangle_chunk_size);
+        setup_triangles(indices, draw_commands, task, begin, end);
+    });
+
+    // Raster, tiles own disjoint pixels
+    parallel_for(_thread_count, _tile_count_x * _tile_count_y, [this](uint32_t tile_index) {
+        rasterize_tile(tile_index);
+    });
+}
+
+void CpuRasterizer::setup_triangles(const std::vector<uint32_t>& indices, const std::vector<DrawCommand>& draw_commands, uint32_t task_index, uint32_t begin, uint32_t end)
+{
+    TriangleBins& bins = _triangle_bins[task_index];
+    bins.triangles.clear();
+    bins.tile_bins.resize(_tile_count_x * _tile_count_y);
+    for (auto& tile_bin : bins.tile_bins)
+    {
+        tile_bin.clear();
+    }
+
+    if (begin >= end)
+        return;
+
+    uint32_t draw_index = (uint32_t)(std::upper_bound(_draw_first_triangles.begin(), _draw_first_triangles.end(), begin) - _draw_first_triangles.begin()) - 1;
+    for (uint32_t triangle_index = begin; triangle_index < end; ++triangle_index)
+    {
+        while (draw_index + 1 < _draw_first_triangles.size() && triangle_index >= _draw_first_triangles[draw_index + 1])
+        {
+            draw_index++;
+        }
+
+        const DrawCommand& draw_command = draw_commands[draw_index];
+        uint32_t primitive_id = triangle_index - _draw_first_triangles[draw_index];
+        const uint32_t* triangle_indices = &indices[draw_command.first_index + primitive_id * 3];
+        glm::vec4 clip_positions[3];
+        for (uint32_t i = 0; i < 3; ++i)
+        {
+            clip_positions[i] = _clip_positions[triangle_indices[i] + draw_command.vertex_offset];
+        }
+
+        setup_triangle(bins, clip_positions, calculate_output_id(draw_index, primitive_id));
+    }
+}
+
+void CpuRasterizer::setup_triangle(TriangleBins& bins, const glm::vec4 clip_positions[3], uint32_t id)
+{
+    // Trivial reject against the side planes
+    for (int axis = 0; axis < 2; ++axis)
+    {
+        if (clip_positions[0][axis] > clip_positions[0].w && clip_positions[1][axis] > clip_positions[1].w && clip_positions[2][axis] > clip_positions[2].w)
+            return;
+        if (clip_positions[0][axis] < -clip_positions[0].w && clip_positions[1][axis] < -clip_positions[1].w && clip_positions[2][axis] < -clip_positions[2].w)
+            return;
+    }
+
+    glm::vec4 polygon[4];
+    uint32_t polygon_count = clip_near_plane(clip_positions, polygon);
+    if (polygon_count < 3)
+        return;
+
+    glm::vec3 screen_positions[4];
+    for (uint32_t i = 0; i < polygon_count; ++i)
+    {
+        glm::vec3 ndc = glm::vec3(polygon[i]) / polygon[i].w;
+        screen_positions[i] = glm::vec3((ndc.x * 0.5f + 0.5f) * (float)_width, (ndc.y * 0.5f + 0.5f) * (float)_height, ndc.z);
+    }
+
+    for (uint32_t fan = 1; fan + 1 < polygon_count; ++fan)
+    {
+        glm::vec3 v[3] = {screen_positions[0], screen_positions[fan], screen_positions[fan + 1]};
+        float area = (v[1].x - v[0].x) * (v[2].y - v[0].y) - (v[1].y - v[0].y) * (v[2].x - v[0].x);
+        if (!(std::abs(area) > 0.0f))
+            continue;
+
+        // No face culling in the visibility buffer pass, both windings are rasterized
+        if (area < 0.0f)
+        {
+            std::swap(v[1], v[2]);
+            area = -area;
+        }
+
+        Triangle triangle;
+        triangle.id = id;
+        triangle.depth_a = 0.0f;
+        triangle.depth_b = 0.0f;
+        triangle.depth_c = 0.0f;
+        for (uint32_t i = 0; i < 3; ++i)
+        {
+            // Edge opposite to vertex i, positive inside
+            const glm::vec3& a = v[(i + 1) % 3];
+            const glm::vec3& b = v[(i + 2) % 3];
+            float edge_a = a.y - b.y;
+            float edge_b = b.x - a.x;
+            triangle.top_left[i] = edge_a > 0.0f || (edge_a == 0.0f && edge_b > 0.0f);
+            triangle.edge_a[i] = edge_a / area;
+            triangle.edge_b[i] = edge_b / area;
+            triangle.edge_c[i] = ((b.y - a.y) * a.x - (b.x - a.x) * a.y) / area;
+            triangle.depth_a += triangle.edge_a[i] * v[i].z;
+            triangle.depth_b += triangle.edge_b[i] * v[i].z;
+            triangle.depth_c += triangle.edge_c[i] * v[i].z;
+        }
+
+        float min_x = std::min(v[0].x, std::min(v[1].x, v[2].x));
+        float min_y = std::min(v[0].y, std::min(v[1].y, v[2].y));
+        float max_x = std::max(v[0].x, std::max(v[1].x, v[2].x));
+        float max_y = std::max(v[0].y, std::max(v[1].y, v[2].y));
+        triangle.min_x = (int32_t)std::max(0.0f, std::floor(min_x));
+        triangle.min_y = (int32_t)std::max(0.0f, std::floor(min_y));
+        triangle.max_x = (int32_t)std::min((float)_width - 1.0f, std::ceil(max_x));
+        triangle.max_y = (int32_t)std::min((float)_height - 1.0f, std::ceil(max_y));
+        if (triangle.min_x > triangle.max_x || triangle.min_y > triangle.max_y)
+            continue;
+
+        uint32_t triangle_index = (uint32_t)bins.triangles.size();
+        bins.triangles.push_back(triangle);
+        for (int32_t tile_y = triangle.min_y / CPU_RASTER_TILE_SIZE; tile_y <= triangle.max_y / CPU_RASTER_TILE_SIZE; ++tile_y)
+        {
+            for (int32_t tile_x = triangle.min_x / CPU_RASTER_TILE_SIZE; tile_x <= triangle.max_x / CPU_RASTER_TILE_SIZE; ++tile_x)
+            {
+                bins.tile_bins[tile_y * _tile_count_x + tile_x].push_back(triangle_index);
+            }
+        }
+    }
+}
+
+void CpuRasterizer::rasterize_tile(uint32_t tile_index)
+{
+    int32_t tile_min_x = (int32_t)(tile_index % _tile_count_x) * CPU_RASTER_TILE_SIZE;
+    int32_t tile_min_y = (int32_t)(tile_index / _tile_count_x) * CPU_RASTER_TILE_SIZE;
+    int32_t tile_max_x = std::min(tile_min_x + CPU_RASTER_TILE_SIZE, (int32_t)_width) - 1;
+    int32_t tile_max_y = std::min(tile_min_y + CPU_RASTER_TILE_SIZE, (int32_t)_height) - 1;
+
+    for (auto& bins : _triangle_bins)
+    {
+        for (uint32_t triangle_index : bins.tile_bins[tile_index])
+        {
+            const Triangle& triangle = bins.triangles[triangle_index];
+            rasterize_triangle(triangle,
+                               std::max(triangle.min_x, tile_min_x), std::max(triangle.min_y, tile_min_y),
+                               std::min(triangle.max_x, tile_max_x), std::min(triangle.max_y, tile_max_y));
+        }
+    }
+}
+
+void CpuRasterizer::rasterize_triangle(const Triangle& triangle, int32_t min_x, int32_t min_y, int32_t max_x, int32_t max_y)
+{
+    // Pixels are sampled at their centers, ties on an edge go to the triangle it is a top or left edge of
+#if defined(CPU_RASTER_SSE2)
+    const __m128 lane_offsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 end_x = _mm_set1_ps((float)max_x + 1.0f);
+    __m128 edge_a[3];
+    __m128 top_left[3];
+    for (int i = 0; i < 3; ++i)
+    {
+        edge_a[i] = _mm_set1_ps(triangle.edge_a[i]);
+        top_left[i] = _mm_castsi128_ps(_mm_set1_epi32(triangle.top_left[i] ? -1 : 0));
+    }
+    const __m128 depth_a = _mm_set1_ps(triangle.depth_a);
+
+    for (int32_t y = min_y; y <= max_y; ++y)
+    {
+        float py = (float)y + 0.5f;
+        __m128 edge_row[3];
+        for (int i = 0; i < 3; ++i)
+        {
+            edge_row[i] = _mm_set1_ps(triangle.edge_b[i] * py + triangle.edge_c[i]);
+        }
+        __m128 depth_row = _mm_set1_ps(triangle.depth_b * py + triangle.depth_c);
+
+        uint32_t* id_row = &_visibility_buffer[y * _width];
+        float* depth_buffer_row = &_depth_buffer[y * _width];
+        for (int32_t x = min_x; x <= max_x; x += 4)
+        {
+            __m128 px = _mm_add_ps(_mm_set1_ps((float)x), lane_offsets);
+            __m128 mask = _mm_cmplt_ps(px, end_x);
+            for (int i = 0; i < 3; ++i)
+            {
+                __m128 edge = _mm_add_ps(_mm_mul_ps(edge_a[i], px), edge_row[i]);
+                __m128 inside = _mm_or_ps(_mm_cmpgt_ps(edge, zero), _mm_and_ps(top_left[i], _mm_cmpeq_ps(edge, zero)));
+                mask = _mm_and_ps(mask, inside);
+            }
+
+            // Interpolation may overshoot [0, 1] slightly, reversed-Z has no far plane to clip against
+            __m128 depth = _mm_add_ps(_mm_mul_ps(depth_a, px), depth_row);
+            mask = _mm_and_ps(mask, _mm_and_ps(_mm_cmpge_ps(depth, zero), _mm_cmple_ps(depth, one)));
+
+            int lanes = _mm_movemask_ps(mask);
+            if (lanes == 0)
+                continue;
+
+            alignas(16) float depths[4];
+            _mm_store_ps(depths, depth);
+            for (int lane = 0; lane < 4; ++lane)
+            {
+                if ((lanes & (1 << lane)) && depths[lane] > depth_buffer_row[x + lane])
+                {
+                    depth_buffer_row[x + lane] = depths[lane];
+                    id_row[x + lane] = triangle.id;
+                }
+            }
+        }
+    }
+#else
+    for (int32_t y = min_y; y <= max_y; ++y)
+    {
+        float py = (float)y + 0.5f;
+        for (int32_t x = min_x; x <= max_x; ++x)
+        {
+            float px = (float)x + 0.5f;
+            bool inside = true;
+            for (int i = 0; i < 3; ++i)
+            {
+                float edge = triangle.edge_a[i] * px + triangle.edge_b[i] * py + triangle.edge_c[i];
+                inside = inside && (edge > 0.0f || (edge == 0.0f && triangle.top_left[i]));
+            }
+
+            float depth = triangle.depth_a * px + triangle.depth_b * py + triangle.depth_c;
+            if (!inside || depth < 0.0f || depth > 1.0f)
+                continue;
+
+            uint32_t pixel_index = y * _width + x;
+            if (depth > _depth_buffer[pixel_index])
+            {
+                _depth_buffer[pixel_index] = depth;
+                _visibility_buffer[pixel_index] = triangle.id;
+            }
+        }
+    }
+#endif
+}
+
+void CpuRasterizer::get_visibility_buffer_bgra(std::vector<uint8_t>& data) const
+{
+    // unpackUnorm4x8 puts the low byte in red
+    data.resize(_visibility_buffer.size() * 4);
+    for (size_t i = 0; i < _visibility_buffer.size(); ++i)
+    {
+        uint32_t id = _visibility_buffer[i];
+        data[i * 4 + 0] = (uint8_t)((id >> 16) & 0xFF);
+        data[i * 4 + 1] = (uint8_t)((id >> 8) & 0xFF);
+        data[i * 4 + 2] = (uint8_t)(id & 0xFF);
+        data[i * 4 + 3] = (uint8_t)((id >> 24) & 0xFF);
+    }
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+
+class Scene;
+class Camera;
+struct DrawCommand;
+
+#define CPU_RASTER_TILE_SIZE 64
+// Clear value of the visibility buffer render target
+#define CPU_RASTER_CLEAR_ID 0xFFFFFFFF
+
+// Reference rasterizer producing the same visibility buffer as VisibilityBufferPass. Triangles
+// are set up and binned into screen tiles by worker threads, then every tile is rasterized by a
+// single thread with SIMD edge functions, so no locks are needed on the framebuffer.
+class CpuRasterizer
+{
+public:
+    // 0 uses every hardware thread
+    CpuRasterizer(uint32_t thread_count = 0);
+
+    // Takes the filtered index buffer and compacted draws of CpuTriangleFiltering, the same inputs as
+    // the indirect draws of the visibility buffer pass, so the draw and primitive ids match the GPU
+    void render(Scene* scene, Camera* camera, const std::vector<uint32_t>& indices, const std::vector<DrawCommand>& draw_commands,
+                uint32_t width, uint32_t height);
+
+    uint32_t get_width() const { return _width; }
+
+    uint32_t get_height() const { return _height; }
+
+    // Packed draw and primitive ids, see CalculateOutputID in visibility_buffer_pass.frag
+    const std::vector<uint32_t>& get_visibility_buffer() const { return _visibility_buffer; }
+
+    const std::vector<float>& get_depth_buffer() const { return _depth_buffer; }
+
+    // Byte layout of the B8G8R8A8_UNORM visibility buffer render target
+    void get_visibility_buffer_bgra(std::vector<uint8_t>& data) const;
+
+private:
+    // Edge functions and depth are planes in screen space, scaled so the edge functions are barycentrics
+    struct Triangle
+    {
+        float edge_a[3];
+        float edge_b[3];
+        float edge_c[3];
+        bool top_left[3];
+        float depth_a;
+        float depth_b;
+        float depth_c;
+        uint32_t id;
+        int32_t min_x;
+        int32_t min_y;
+        int32_t max_x;
+        int32_t max_y;
+    };
+
+    // Written by a single setup task, tiles walk the bins of every task in order so the
+    // submission order of the triangles is kept
+    struct TriangleBins
+    {
+        std::vector<Triangle> triangles;
+        std::vector<std::vector<uint32_t>> tile_bins;
+    };
+
+    void setup_triangles(const std::vector<uint32_t>& indices, const std::vector<DrawCommand>& draw_commands, uint32_t task_index, uint32_t begin, uint32_t end);
+
+    void setup_triangle(TriangleBins& bins, const glm::vec4 clip_positions[3], uint32_t id);
+
+    void rasterize_tile(uint32_t tile_index);
+
+    void rasterize_triangle(const Triangle& triangle, int32_t min_x, int32_t min_y, int32_t max_x, int32_t max_y);
+
+    uint32_t _thread_count;
+    uint32_t _width = 0;
+    uint32_t _height = 0;
+    uint32_t _tile_count_x = 0;
+    uint32_t _tile_count_y = 0;
+    std::vector<uint32_t> _draw_first_triangles;
+    std::vector<glm::vec4> _clip_positions;
+    std::vector<TriangleBins> _triangle_bins;
+    std::vector<uint32_t> _visibility_buffer;
+    std::vector<float> _depth_buffer;
+};
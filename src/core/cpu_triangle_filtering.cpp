@@ -0,0 +1,146 @@
+#include "cpu_triangle_filtering.h"
+#include "scene.h"
+#include "cpu_profiler.h"
+#include "parallel.h"
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define CPU_FILTERING_SSE2
+#endif
+
+// Bits: x > w, y > w, z > w, x < -w, y < -w, z < 0
+// Reversed-Z: z > w is nearer to the camera than the near plane, z < 0 never happens with the infinite far plane
+static uint32_t get_outcode(const glm::mat4& m, const float* position)
+{
+#if defined(CPU_FILTERING_SSE2)
+    __m128 clip = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&m[0][0]), _mm_set1_ps(position[0])),
+                                        _mm_mul_ps(_mm_loadu_ps(&m[1][0]), _mm_set1_ps(position[1]))),
+                             _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&m[2][0]), _mm_set1_ps(position[2])),
+                                        _mm_loadu_ps(&m[3][0])));
+    __m128 w = _mm_shuffle_ps(clip, clip, _MM_SHUFFLE(3, 3, 3, 3));
+    __m128 z = _mm_shuffle_ps(clip, clip, _MM_SHUFFLE(2, 2, 2, 2));
+    uint32_t positive = (uint32_t)_mm_movemask_ps(_mm_cmpgt_ps(clip, w)) & 0x7;
+    uint32_t negative = (uint32_t)_mm_movemask_ps(_mm_cmplt_ps(clip, _mm_sub_ps(_mm_setzero_ps(), w))) & 0x3;
+    uint32_t behind = (uint32_t)_mm_movemask_ps(_mm_cmplt_ss(z, _mm_setzero_ps())) & 0x1;
+    return positive | (negative << 3) | (behind << 5);
+#else
+    glm::vec4 clip = m * glm::vec4(position[0], position[1], position[2], 1.0f);
+    uint32_t outcode = 0;
+    outcode |= clip.x > clip.w ? 0x01 : 0;
+    outcode |= clip.y > clip.w ? 0x02 : 0;
+    outcode |= clip.z > clip.w ? 0x04 : 0;
+    outcode |= clip.x < -clip.w ? 0x08 : 0;
+    outcode |= clip.y < -clip.w ? 0x10 : 0;
+    outcode |= clip.z < 0.0f ? 0x20 : 0;
+    return outcode;
+#endif
+}
+
+CpuTriangleFiltering::CpuTriangleFiltering(uint32_t thread_count)
+{
+    _thread_count = get_worker_thread_count(thread_count);
+}
+
+void CpuTriangleFiltering::filter(Scene* scene, const glm::mat4& view_proj_matrix, const ClusterCullingResult& culling_result)
+{
+    filter_batches(scene, &view_proj_matrix, 1, culling_result.batches);
+}
+
+void CpuTriangleFiltering::filter(Scene* scene, const std::vector<glm::mat4>& view_proj_matrices, const MultiViewCullingResult& culling_result)
+{
+    filter_batches(scene, view_proj_matrices.data(), (uint32_t)view_proj_matrices.size(), culling_result.batches);
+}
+
+void CpuTriangleFiltering::filter_batches(Scene* scene, const glm::mat4* view_proj_matrices, uint32_t view_count, const std::vector<SmallBatchData>& batches)
+{
+    PROFILE_SCOPE("cpu_triangle_filtering");
+
+    // Clear buffers
+    _filtered_indices.resize(scene->indices.size() * view_count);
+    _uncompacted_draw_commands.assign(MAX_DRAW_CMD_COUNT, UncompactedDrawCommand{0, 0, 0});
+    _counters = {};
+
+    // Batches of a draw are contiguous, a draw never spans two chunks
+    _draw_ranges.clear();
+    for (uint32_t i = 0; i < batches.size(); ++i)
+    {
+        if (_draw_ranges.empty() || batches[i].accum_draw_index != batches[_draw_ranges.back().first_batch].accum_draw_index)
+            _draw_ranges.push_back({i, i, 0, 0});
+        _draw_ranges.back().end_batch = i + 1;
+    }
+
+    parallel_for(_thread_count, (uint32_t)_draw_ranges.size(), [&](uint32_t draw_range_index) {
+        filter_draw(scene, view_proj_matrices, batches, _draw_ranges[draw_range_index]);
+    });
+
+    _counters.batch_count = (uint32_t)batches.size();
+    for (auto& draw_range : _draw_ranges)
+    {
+        _counters.input_triangle_count += draw_range.input_triangle_count;
+        _counters.output_triangle_count += draw_range.output_triangle_count;
+    }
+
+    batch_compaction();
+}
+
+void CpuTriangleFiltering::filter_draw(Scene* scene, const glm::mat4* view_proj_matrices, const std::vector<SmallBatchData>& batches, DrawRange& draw_range)
+{
+    const SmallBatchData& first_batch = batches[draw_range.first_batch];
+    // A draw belongs to a single view
+    const glm::mat4& view_proj_matrix = view_proj_matrices[first_batch.view_index];
+    uint32_t output_index = first_batch.output_index_offset;
+    for (uint32_t i = draw_range.first_batch; i < draw_range.end_batch; ++i)
+    {
+        const SmallBatchData& batch = batches[i];
+        uint32_t input_index_offset = scene->mesh_constants[batch.mesh_index].index_offset + batch.index_offset;
+        for (uint32_t face = 0; face < batch.face_count; ++face)
+        {
+            const uint32_t* indices = &scene->indices[input_index_offset + face * 3];
+
+            // Same tests as filter_triangle in triangle_filtering.comp
+            if (indices[0] == indices[1] || indices[1] == indices[2] || indices[0] == indices[2])
+                continue;
+
+            uint32_t outcode = get_outcode(view_proj_matrix, &scene->positions[indices[0] * 3]);
+            outcode &= get_outcode(view_proj_matrix, &scene->positions[indices[1] * 3]);
+            outcode &= get_outcode(view_proj_matrix, &scene->positions[indices[2] * 3]);
+            if (outcode != 0)
+                continue;
+
+            _filtered_indices[output_index++] = indices[0];
+            _filtered_indices[output_index++] = indices[1];
+            _filtered_indices[output_index++] = indices[2];
+        }
+        draw_range.input_triangle_count += batch.face_count;
+    }
+
+    uint32_t num_indices = output_index - first_batch.output_index_offset;
+    draw_range.output_triangle_count = num_indices / 3;
+
+    UncompactedDrawCommand& draw_command = _uncompacted_draw_commands[first_batch.accum_draw_index];
+    draw_command.num_indices = num_indices;
+    draw_command.start_index = first_batch.output_index_offset;
+    draw_command.mesh_index = first_batch.mesh_index;
+}
+
+void CpuTriangleFiltering::batch_compaction()
+{
+    // batch_compaction.comp skips the last slot as well
+    _draw_commands.clear();
+    _draw_mesh_indices.clear();
+    for (uint32_t i = 0; i < MAX_DRAW_CMD_COUNT - 1; ++i)
+    {
+        const UncompactedDrawCommand& uncompacted_draw_command = _uncompacted_draw_commands[i];
+        if (uncompacted_draw_command.num_indices == 0)
+            continue;
+
+        DrawCommand draw_command;
+        draw_command.index_count = uncompacted_draw_command.num_indices;
+        draw_command.instance_count = 1;
+        draw_command.first_index = uncompacted_draw_command.start_index;
+        draw_command.vertex_offset = 0;
+        draw_command.first_instance = 0;
+        _draw_commands.push_back(draw_command);
+        _draw_mesh_indices.push_back(uncompacted_draw_command.mesh_index);
+    }
+    _counters.count = (uint32_t)_draw_commands.size();
+}
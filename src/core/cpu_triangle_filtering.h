@@ -0,0 +1,57 @@
+#pragma once
+
+#include "cluster_culling.h"
+#include "scene.h"
+#include <glm/glm.hpp>
+#include <vector>
+
+// Host port of clear_buffers.comp, triangle_filtering.comp and batch_compaction.comp. Consumes the
+// batches of cull_clusters and produces the filtered index buffer and the compacted indirect draws.
+// Draws are independent and filtered in parallel; inside a draw the batches keep their order, so the
+// output is deterministic where the GPU order depends on its atomics.
+class CpuTriangleFiltering
+{
+public:
+    // 0 uses every hardware thread
+    CpuTriangleFiltering(uint32_t thread_count = 0);
+
+    void filter(Scene* scene, const glm::mat4& view_proj_matrix, const ClusterCullingResult& culling_result);
+
+    // Every batch is filtered with view_proj_matrices[view_index], the uncompacted draws are the draws of the views
+    void filter(Scene* scene, const std::vector<glm::mat4>& view_proj_matrices, const MultiViewCullingResult& culling_result);
+
+    // The scene index buffer size times the view count, only the ranges of the draws are written
+    const std::vector<uint32_t>& get_filtered_indices() const { return _filtered_indices; }
+
+    const std::vector<UncompactedDrawCommand>& get_uncompacted_draw_commands() const { return _uncompacted_draw_commands; }
+
+    const std::vector<DrawCommand>& get_draw_commands() const { return _draw_commands; }
+
+    // Mesh of every compacted draw
+    const std::vector<uint32_t>& get_draw_mesh_indices() const { return _draw_mesh_indices; }
+
+    const DrawCounter& get_counters() const { return _counters; }
+
+private:
+    struct DrawRange
+    {
+        uint32_t first_batch;
+        uint32_t end_batch;
+        uint32_t input_triangle_count;
+        uint32_t output_triangle_count;
+    };
+
+    void filter_batches(Scene* scene, const glm::mat4* view_proj_matrices, uint32_t view_count, const std::vector<SmallBatchData>& batches);
+
+    void filter_draw(Scene* scene, const glm::mat4* view_proj_matrices, const std::vector<SmallBatchData>& batches, DrawRange& draw_range);
+
+    void batch_compaction();
+
+    uint32_t _thread_count;
+    std::vector<DrawRange> _draw_ranges;
+    std::vector<uint32_t> _filtered_indices;
+    std::vector<UncompactedDrawCommand> _uncompacted_draw_commands;
+    std::vector<DrawCommand> _draw_commands;
+    std::vector<uint32_t> _draw_mesh_indices;
+    DrawCounter _counters{};
+};
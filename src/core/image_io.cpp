@@ -0,0 +1,160 @@
+#include "image_io.h"
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+
+bool write_ppm(const std::string& file_path, uint32_t width, uint32_t height, const std::vector<uint8_t>& bgra_data)
+{
+    std::ofstream file(file_path, std::ios::binary);
+    if (!file.is_open())
+        return false;
+
+    file << "P6\n" << width << " " << height << "\n255\n";
+    std::vector<uint8_t> rgb_data(width * height * 3);
+    for (uint32_t i = 0; i < width * height; ++i)
+    {
+        rgb_data[i * 3 + 0] = bgra_data[i * 4 + 2];
+        rgb_data[i * 3 + 1] = bgra_data[i * 4 + 1];
+        rgb_data[i * 3 + 2] = bgra_data[i * 4 + 0];
+    }
+    file.write((const char*)rgb_data.data(), rgb_data.size());
+    return file.good();
+}
+
+bool read_ppm(const std::string& file_path, uint32_t& width, uint32_t& height, std::vector<uint8_t>& bgra_data)
+{
+    std::ifstream file(file_path, std::ios::binary);
+    if (!file.is_open())
+        return false;
+
+    std::string magic;
+    uint32_t max_value = 0;
+    file >> magic >> width >> height >> max_value;
+    if (magic != "P6" || max_value != 255)
+        return false;
+    file.get();
+
+    std::vector<uint8_t> rgb_data(width * height * 3);
+    file.read((char*)rgb_data.data(), rgb_data.size());
+    if (!file.good())
+        return false;
+
+    bgra_data.resize(width * height * 4);
+    for (uint32_t i = 0; i < width * height; ++i)
+    {
+        bgra_data[i * 4 + 0] = rgb_data[i * 3 + 2];
+        bgra_data[i * 4 + 1] = rgb_data[i * 3 + 1];
+        bgra_data[i * 4 + 2] = rgb_data[i * 3 + 0];
+        bgra_data[i * 4 + 3] = 255;
+    }
+    return true;
+}
+
+
+bool write_pam(const std::string& file_path, uint32_t width, uint32_t height, const std::vector<uint8_t>& bgra_data)
+{
+    std::ofstream file(file_path, std::ios::binary);
+    if (!file.is_open())
+        return false;
+
+    file << "P7\nWIDTH " << width << "\nHEIGHT " << height << "\nDEPTH 4\nMAXVAL 255\nTUPLTYPE RGB_ALPHA\nENDHDR\n";
+    std::vector<uint8_t> rgba_data(width * height * 4);
+    for (uint32_t i = 0; i < width * height; ++i)
+    {
+        rgba_data[i * 4 + 0] = bgra_data[i * 4 + 2];
+        rgba_data[i * 4 + 1] = bgra_data[i * 4 + 1];
+        rgba_data[i * 4 + 2] = bgra_data[i * 4 + 0];
+        rgba_data[i * 4 + 3] = bgra_data[i * 4 + 3];
+    }
+    file.write((const char*)rgba_data.data(), rgba_data.size());
+    return file.good();
+}
+
+bool read_pam(const std::string& file_path, uint32_t& width, uint32_t& height, std::vector<uint8_t>& bgra_data)
+{
+    std::ifstream file(file_path, std::ios::binary);
+    if (!file.is_open())
+        return false;
+
+    std::string token;
+    file >> token;
+    if (token != "P7")
+        return false;
+
+    uint32_t depth = 0;
+    uint32_t max_value = 0;
+    width = 0;
+    height = 0;
+    while (file >> token && token != "ENDHDR")
+    {
+        if (token == "WIDTH")
+            file >> width;
+        else if (token == "HEIGHT")
+            file >> height;
+        else if (token == "DEPTH")
+            file >> depth;
+        else if (token == "MAXVAL")
+            file >> max_value;
+        else
+            file >> token;
+    }
+    if (depth != 4 || max_value != 255)
+        return false;
+    file.get();
+
+    std::vector<uint8_t> rgba_data(width * height * 4);
+    file.read((char*)rgba_data.data(), rgba_data.size());
+    if (!file.good())
+        return false;
+
+    bgra_data.resize(width * height * 4);
+    for (uint32_t i = 0; i < width * height; ++i)
+    {
+        bgra_data[i * 4 + 0] = rgba_data[i * 4 + 2];
+        bgra_data[i * 4 + 1] = rgba_data[i * 4 + 1];
+        bgra_data[i * 4 + 2] = rgba_data[i * 4 + 0];
+        bgra_data[i * 4 + 3] = rgba_data[i * 4 + 3];
+    }
+    return true;
+}
+
+ImageCompareResult compare_images(const std::vector<uint8_t>& expected_bgra, const std::vector<uint8_t>& actual_bgra, uint32_t width, uint32_t height, uint32_t tolerance, std::vector<uint8_t>* diff_bgra)
+{
+    ImageCompareResult result;
+    result.pixel_count = width * height;
+    if (diff_bgra)
+        diff_bgra->resize(width * height * 4);
+
+    for (uint32_t i = 0; i < width * height; ++i)
+    {
+        uint32_t difference = 0;
+        for (uint32_t c = 0; c < 4; ++c)
+        {
+            difference = std::max(difference, (uint32_t)std::abs((int)expected_bgra[i * 4 + c] - (int)actual_bgra[i * 4 + c]));
+        }
+        result.max_difference = std::max(result.max_difference, difference);
+
+        bool mismatch = difference > tolerance;
+        if (mismatch)
+            result.mismatch_count++;
+
+        if (diff_bgra)
+        {
+            uint8_t* pixel = &(*diff_bgra)[i * 4];
+            if (mismatch)
+            {
+                pixel[0] = 0;
+                pixel[1] = 0;
+                pixel[2] = 255;
+            }
+            else
+            {
+                pixel[0] = expected_bgra[i * 4 + 0] / 4;
+                pixel[1] = expected_bgra[i * 4 + 1] / 4;
+                pixel[2] = expected_bgra[i * 4 + 2] / 4;
+            }
+            pixel[3] = 255;
+        }
+    }
+    return result;
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Binary PPM (P6), dependency free so headless hosts can dump frames without an image library
+bool write_ppm(const std::string& file_path, uint32_t width, uint32_t height, const std::vector<uint8_t>& bgra_data);
+
+bool read_ppm(const std::string& file_path, uint32_t& width, uint32_t& height, std::vector<uint8_t>& bgra_data);
+
+// PAM (P7) with alpha, lossless for packed data such as visibility buffer IDs
+bool write_pam(const std::string& file_path, uint32_t width, uint32_t height, const std::vector<uint8_t>& bgra_data);
+
+bool read_pam(const std::string& file_path, uint32_t& width, uint32_t& height, std::vector<uint8_t>& bgra_data);
+
+struct ImageCompareResult
+{
+    uint32_t pixel_count = 0;
+    uint32_t mismatch_count = 0;
+    uint32_t max_difference = 0;
+};
+
+// A pixel mismatches when any channel differs by more than tolerance. The optional diff image shows
+// mismatches in red over a dimmed copy of the expected image.
+ImageCompareResult compare_images(const std::vector<uint8_t>& expected_bgra, const std::vector<uint8_t>& actual_bgra, uint32_t width, uint32_t height, uint32_t tolerance, std::vector<uint8_t>* diff_bgra);
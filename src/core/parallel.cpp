@@ -0,0 +1,127 @@
+#include "parallel.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Set on every thread taking part in a parallel_for, nested calls run inline
+static thread_local bool t_in_parallel_for = false;
+
+// Threads started on first use and parked between jobs, so a parallel_for costs a wake up
+// instead of creating and joining threads. One job at a time, a caller finding the pool busy
+// runs its tasks alone.
+class WorkerPool
+{
+public:
+    ~WorkerPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _exit = true;
+        }
+        _wake.notify_all();
+        for (auto& thread : _threads)
+        {
+            thread.join();
+        }
+    }
+
+    bool try_run(uint32_t helper_count, const std::function<void()>& job)
+    {
+        std::unique_lock<std::mutex> run_lock(_run_mutex, std::try_to_lock);
+        if (!run_lock.owns_lock())
+            return false;
+
+        std::unique_lock<std::mutex> lock(_mutex);
+        while (_threads.size() < helper_count)
+        {
+            uint32_t index = (uint32_t)_threads.size();
+            _threads.emplace_back([this, index]() { work(index); });
+        }
+        _job = &job;
+        _helper_count = helper_count;
+        _busy_count = helper_count;
+        _generation++;
+        lock.unlock();
+        _wake.notify_all();
+
+        job();
+
+        lock.lock();
+        _done.wait(lock, [this]() { return _busy_count == 0; });
+        _job = nullptr;
+        return true;
+    }
+
+private:
+    void work(uint32_t index)
+    {
+        t_in_parallel_for = true;
+        uint64_t generation = 0;
+        std::unique_lock<std::mutex> lock(_mutex);
+        while (true)
+        {
+            _wake.wait(lock, [&]() { return _exit || _generation != generation; });
+            if (_exit)
+                return;
+
+            generation = _generation;
+            if (index >= _helper_count)
+                continue;
+
+            const std::function<void()>* job = _job;
+            lock.unlock();
+            (*job)();
+            lock.lock();
+            if (--_busy_count == 0)
+                _done.notify_one();
+        }
+    }
+
+    std::mutex _run_mutex;
+    std::mutex _mutex;
+    std::condition_variable _wake;
+    std::condition_variable _done;
+    std::vector<std::thread> _threads;
+    const std::function<void()>* _job = nullptr;
+    uint32_t _helper_count = 0;
+    uint32_t _busy_count = 0;
+    uint64_t _generation = 0;
+    bool _exit = false;
+};
+
+static WorkerPool& get_worker_pool()
+{
+    static WorkerPool worker_pool;
+    return worker_pool;
+}
+
+uint32_t get_worker_thread_count(uint32_t thread_count)
+{
+    return thread_count > 0 ? thread_count : std::max(1u, std::thread::hardware_concurrency());
+}
+
+void parallel_for(uint32_t thread_count, uint32_t task_count, const std::function<void(uint32_t)>& func)
+{
+    std::atomic<uint32_t> next_task{0};
+    std::function<void()> worker = [&]() {
+        for (uint32_t task = next_task++; task < task_count; task = next_task++)
+        {
+            func(task);
+        }
+    };
+
+    uint32_t worker_count = std::min(thread_count, task_count);
+    if (worker_count <= 1 || t_in_parallel_for)
+    {
+        worker();
+        return;
+    }
+
+    t_in_parallel_for = true;
+    if (!get_worker_pool().try_run(worker_count - 1, worker))
+        worker();
+    t_in_parallel_for = false;
+}
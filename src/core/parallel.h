@@ -0,0 +1,11 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+
+// 0 picks every hardware thread
+uint32_t get_worker_thread_count(uint32_t thread_count);
+
+// Tasks are pulled from a shared counter by up to thread_count threads, the calling thread included.
+// The other threads come from a pool kept alive between calls, nested calls run on the caller.
+void parallel_for(uint32_t thread_count, uint32_t task_count, const std::function<void(uint32_t)>& func);
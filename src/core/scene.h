@@ -0,0 +1,105 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include <math/bounding_box.h>
+
+// Default cluster size, scenes can be cooked with any of the supported sizes
+#define CLUSTER_SIZE 256
+
+struct ClusterCompact
+{
+    uint32_t triangle_count;
+    uint32_t cluster_start;
+};
+
+struct Cluster
+{
+    glm::vec3 aabb_min, aabb_max;
+    glm::vec3 cone_center, cone_axis;
+    float cone_angle_cosine;
+    float distance_from_camera;
+    bool valid;
+};
+
+struct Mesh
+{
+    std::vector<ClusterCompact> compacts;
+    std::vector<Cluster> clusters;
+};
+
+struct MeshConstants
+{
+    uint32_t face_count;
+    uint32_t index_offset;
+    // Into Scene::materials
+    uint32_t material_index;
+};
+
+// Same layout as VkDrawIndexedIndirectCommand
+struct DrawCommand
+{
+    uint32_t index_count;
+    uint32_t instance_count;
+    uint32_t first_index;
+    int32_t vertex_offset;
+    uint32_t first_instance;
+};
+
+#define LIGHT_TYPE_POINT 0
+#define LIGHT_TYPE_SPOT 1
+
+// Keep in sync with Light in shader_defs.glsl (std430)
+struct Light
+{
+    glm::vec3 position;
+    // Distance the light falls off to zero at, bounds it for the tile culling
+    float range;
+    // Premultiplied by the intensity
+    glm::vec3 color;
+    uint32_t type;
+    // Spot lights only
+    glm::vec3 direction;
+    float spot_cos_outer;
+    float spot_cos_inner;
+    float padding[3];
+};
+
+// glTF metallic-roughness material. Textures index Scene::textures, -1 when unset. Only the
+// factors are shaded, the textures are imported for later use and never sampled.
+struct Material
+{
+    glm::vec4 base_color_factor = glm::vec4(1.0f);
+    glm::vec3 emissive_factor = glm::vec3(0.0f);
+    float metallic_factor = 0.0f;
+    float roughness_factor = 1.0f;
+    int32_t base_color_texture = -1;
+    int32_t metallic_roughness_texture = -1;
+    int32_t normal_texture = -1;
+    int32_t emissive_texture = -1;
+};
+
+// CPU side only, the renderer uploads it into a GpuScene
+class Scene
+{
+public:
+    std::vector<Mesh> meshs;
+    std::vector<DrawCommand> draw_commands;
+    std::vector<float> positions;
+    std::vector<float> normals;
+    std::vector<float> uvs;
+    std::vector<uint32_t> indices;
+    std::vector<MeshConstants> mesh_constants;
+    // Point and spot lights, the sun is set on the renderer
+    std::vector<Light> lights;
+    // Never empty, index 0 is a white dielectric for primitives without a material
+    std::vector<Material> materials;
+    // Image files of the material textures, empty for images embedded in the glTF buffers
+    std::vector<std::string> textures;
+    uint32_t vertex_count = 0;
+    uint32_t index_count = 0;
+    uint32_t cluster_size = CLUSTER_SIZE;
+    // Bump after editing any of the above, the renderer reuploads and drops its cached culling results
+    uint64_t version = 0;
+    BoundingBox bounds;
+};
\ No newline at end of file
@@ -0,0 +1,427 @@
+#include "scene_importer.h"
+#include "scene.h"
+#include "cpu_profiler.h"
+#include "parallel.h"
+#include <core/path.h>
+#include <glm/glm.hpp>
+#include <glm/gtx/quaternion.hpp>
+#include <glm/gtx/matrix_decompose.hpp>
+#include <glm/gtx/euler_angles.hpp>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <random>
+#define CGLTF_IMPLEMENTATION
+#include <cgltf.h>
+
+glm::mat4 get_local_matrix(cgltf_node* node)
+{
+    glm::vec3 translation = glm::vec3(0.0f);
+    if (node->has_translation)
+    {
+        translation.x = node->translation[0];
+        translation.y = node->translation[1];
+        translation.z = node->translation[2];
+    }
+
+    glm::quat rotation = glm::quat(1, 0, 0, 0);
+    if (node->has_rotation)
+    {
+        rotation.x = node->rotation[0];
+        rotation.y = node->rotation[1];
+        rotation.z = node->rotation[2];
+        rotation.w = node->rotation[3];
+    }
+
+    glm::vec3 scale = glm::vec3(1.0f);
+    if (node->has_scale)
+    {
+        scale.x = node->scale[0];
+        scale.y = node->scale[1];
+        scale.z = node->scale[2];
+    }
+
+    glm::mat4 r, t, s;
+    r = glm::toMat4(rotation);
+    t = glm::translate(glm::mat4(1.0), translation);
+    s = glm::scale(glm::mat4(1.0), scale);
+    return t * r * s;
+}
+
+glm::mat4 get_world_matrix(cgltf_node* node)
+{
+    cgltf_node* cur_node = node;
+    glm::mat4 out = get_local_matrix(cur_node);
+
+    while (cur_node->parent != nullptr)
+    {
+        cur_node = cur_node->parent;
+        out = get_local_matrix(cur_node) * out;
+    }
+    return out;
+}
+
+cgltf_attribute* get_gltf_attribute(cgltf_primitive* primitive, cgltf_attribute_type type)
+{
+    for (int i = 0; i < primitive->attributes_count; i++)
+    {
+        cgltf_attribute* att = &primitive->attributes[i];
+        if(att->type == type)
+            return att;
+    }
+    return nullptr;
+}
+
+// KHR_lights_punctual point and spot lights, directional lights are left to the renderer's sun
+static void import_light(cgltf_node* node, Scene* scene)
+{
+    cgltf_light* clight = node->light;
+    if (clight->type != cgltf_light_type_point && clight->type != cgltf_light_type_spot)
+        return;
+
+    glm::mat4 transform = get_world_matrix(node);
+    Light light{};
+    light.position = glm::vec3(transform[3]);
+    // Spot lights shine down their local -Z
+    light.direction = glm::normalize(-glm::vec3(transform[2]));
+    light.color = glm::vec3(clight->color[0], clight->color[1], clight->color[2]) * clight->intensity;
+    light.type = clight->type == cgltf_light_type_spot ? LIGHT_TYPE_SPOT : LIGHT_TYPE_POINT;
+    light.spot_cos_outer = std::cos(clight->spot_outer_cone_angle);
+    light.spot_cos_inner = std::cos(clight->spot_inner_cone_angle);
+    // No range is infinite, cut where the falloff drops below 1/256 of the brightest channel
+    float max_intensity = glm::max(light.color.x, glm::max(light.color.y, light.color.z));
+    light.range = clight->range > 0.0f ? clight->range : std::sqrt(max_intensity * 256.0f);
+    scene->lights.push_back(light);
+}
+
+// Images are indexed like the glTF images, textures without an image are left unset
+static int32_t get_texture_index(const cgltf_texture_view& texture_view, cgltf_data* data)
+{
+    if (!texture_view.texture || !texture_view.texture->image)
+        return -1;
+    return (int32_t)(texture_view.texture->image - data->images);
+}
+
+static Material import_material(cgltf_material* cmaterial, cgltf_data* data)
+{
+    Material material{};
+    if (cmaterial->has_pbr_metallic_roughness)
+    {
+        const cgltf_pbr_metallic_roughness& pbr = cmaterial->pbr_metallic_roughness;
+        material.base_color_factor = glm::vec4(pbr.base_color_factor[0], pbr.base_color_factor[1], pbr.base_color_factor[2], pbr.base_color_factor[3]);
+        material.metallic_factor = pbr.metallic_factor;
+        material.roughness_factor = pbr.roughness_factor;
+        material.base_color_texture = get_texture_index(pbr.base_color_texture, data);
+        material.metallic_roughness_texture = get_texture_index(pbr.metallic_roughness_texture, data);
+    }
+    material.emissive_factor = glm::vec3(cmaterial->emissive_factor[0], cmaterial->emissive_factor[1], cmaterial->emissive_factor[2]);
+    material.normal_texture = get_texture_index(cmaterial->normal_texture, data);
+    material.emissive_texture = get_texture_index(cmaterial->emissive_texture, data);
+    return material;
+}
+
+void add_random_lights(Scene* scene, uint32_t count, uint32_t seed)
+{
+    if (count == 0)
+        return;
+
+    std::mt19937 generator(seed);
+    std::uniform_real_distribution<float> distribution(0.0f, 1.0f);
+
+    glm::vec3 size = scene->bounds.get_size();
+    float range = glm::length(size) * 0.1f;
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        Light light{};
+        light.position = scene->bounds.bb_min + size * glm::vec3(distribution(generator), distribution(generator), distribution(generator));
+        light.range = range;
+        // Full brightness about a third of the range away
+        light.color = glm::vec3(distribution(generator), distribution(generator), distribution(generator)) * range * range * 0.1f;
+        // Every fourth one a spot light pointing down
+        light.type = i % 4 == 3 ? LIGHT_TYPE_SPOT : LIGHT_TYPE_POINT;
+        light.direction = glm::vec3(0.0f, -1.0f, 0.0f);
+        light.spot_cos_outer = std::cos(glm::radians(45.0f));
+        light.spot_cos_inner = std::cos(glm::radians(30.0f));
+        scene->lights.push_back(light);
+    }
+    scene->version++;
+}
+
+void widen_indices(const uint16_t* src, uint32_t index_count, uint32_t* dst)
+{
+    for (uint32_t i = 0; i < index_count; ++i)
+    {
+        dst[i] = (uint32_t)src[i];
+    }
+}
+
+bool is_supported_cluster_size(uint32_t cluster_size)
+{
+    return cluster_size == 64 || cluster_size == 128 || cluster_size == 256;
+}
+
+// Based on "AMD GeometryFX" - https://github.com/GPUOpen-Effects/GeometryFX
+// The cluster size is a template parameter so the per triangle loops have a constant trip count
+template <uint32_t cluster_size>
+static void build_clusters(const float* position_data, const uint32_t* index_data, uint32_t triangle_count, uint32_t thread_count, Mesh& mesh)
+{
+    uint32_t cluster_count = (triangle_count + cluster_size - 1) / cluster_size;
+    mesh.clusters.resize(cluster_count);
+    mesh.compacts.resize(cluster_count);
+
+    // Clusters are independent, each task writes its own slot
+    parallel_for(thread_count, cluster_count, [&](uint32_t k) {
+        uint32_t start = k * cluster_size;
+        uint32_t end = glm::min(start + cluster_size, triangle_count);
+
+        glm::vec3 cone_axis = glm::vec3(0.0f, 0.0f, 0.0f);
+        BoundingBox bounds;
+        for (size_t triangle_index = start; triangle_index < end; ++triangle_index)
+        {
+            int idx0 = (int)index_data[triangle_index * 3 + 0];
+            int idx1 = (int)index_data[triangle_index * 3 + 1];
+            int idx2 = (int)index_data[triangle_index * 3 + 2];
+            glm::vec3 v0(position_data[idx0 * 3], position_data[idx0 * 3 + 1], position_data[idx0 * 3 + 2]);
+            glm::vec3 v1(position_data[idx1 * 3], position_data[idx1 * 3 + 1], position_data[idx1 * 3 + 2]);
+            glm::vec3 v2(position_data[idx2 * 3], position_data[idx2 * 3 + 1], position_data[idx2 * 3 + 2]);
+            bounds.merge(v0);
+            bounds.merge(v1);
+            bounds.merge(v2);
+            glm::vec3 triangle_normal = glm::normalize(glm::cross(v1 - v0, v2 - v0));
+            cone_axis = cone_axis - triangle_normal;
+        }
+
+        float cone_opening = 1;
+        bool valid_cluster = true;
+        if (cone_axis == glm::vec3(0.0, 0.0, 0.0))
+            valid_cluster = false;
+        cone_axis = glm::normalize(cone_axis);
+        glm::vec3 center = bounds.get_center();
+
+        float t = NEG_INF;
+        for (size_t triangle_index = start; triangle_index < end; ++triangle_index)
+        {
+            int idx0 = (int)index_data[triangle_index * 3 + 0];
+            int idx1 = (int)index_data[triangle_index * 3 + 1];
+            int idx2 = (int)index_data[triangle_index * 3 + 2];
+            glm::vec3 v0(position_data[idx0 * 3], position_data[idx0 * 3 + 1], position_data[idx0 * 3 + 2]);
+            glm::vec3 v1(position_data[idx1 * 3], position_data[idx1 * 3 + 1], position_data[idx1 * 3 + 2]);
+            glm::vec3 v2(position_data[idx2 * 3], position_data[idx2 * 3 + 1], position_data[idx2 * 3 + 2]);
+            glm::vec3 triangle_normal = glm::normalize(glm::cross(v1 - v0, v2 - v0));
+
+            const float directional_part = glm::dot(cone_axis, -triangle_normal);
+
+            if (directional_part <= 0)
+            {
+                // No solution for this cluster - at least two triangles are facing each other
+                valid_cluster = false;
+                break;
+            }
+
+            // We need to intersect the plane with our cone ray which is center + t * coneAxis, and find the max
+            // t along the cone ray (which points into the empty space) See: https://en.wikipedia.org/wiki/Line%E2%80%93plane_intersection
+            const float td = dot(center - v0, triangle_normal) / -directional_part;
+
+            t = glm::max(t, td);
+
+            cone_opening = glm::min(cone_opening, directional_part);
+        }
+
+        Cluster cluster{};
+        cluster.aabb_max = bounds.bb_max;
+        cluster.aabb_min = bounds.bb_min;
+        cluster.cone_axis = cone_axis;
+        cluster.cone_center = center + cone_axis * t;
+        // cos (PI/2 - acos (coneOpening))
+        cluster.cone_angle_cosine = glm::sqrt(1 - cone_opening * cone_opening);
+
+        // AMD_GEOMETRY_FX_ENABLE_CLUSTER_CENTER_SAFETY_CHECK
+        float aabb_size = glm::length(bounds.get_size());
+        float cone_center_to_center_distance = glm::length(cluster.cone_center - center);
+        if (cone_center_to_center_distance > (16 * aabb_size))
+            valid_cluster = false;
+        cluster.valid = valid_cluster;
+
+        ClusterCompact compact{};
+        compact.cluster_start = start;
+        compact.triangle_count = end - start;
+
+        mesh.clusters[k] = cluster;
+        mesh.compacts[k] = compact;
+    });
+}
+
+void build_clusters(const float* position_data, const uint32_t* index_data, uint32_t triangle_count, uint32_t cluster_size, uint32_t thread_count, Mesh& mesh)
+{
+    PROFILE_SCOPE("build_clusters");
+
+    switch (cluster_size)
+    {
+        case 64:
+            build_clusters<64>(position_data, index_data, triangle_count, thread_count, mesh);
+            break;
+        case 128:
+            build_clusters<128>(position_data, index_data, triangle_count, thread_count, mesh);
+            break;
+        case 256:
+            build_clusters<256>(position_data, index_data, triangle_count, thread_count, mesh);
+            break;
+        default:
+            assert(0);
+            break;
+    }
+}
+
+Scene* load_scene(const std::string& file_path, uint32_t cluster_size)
+{
+    PROFILE_SCOPE("load_scene");
+
+    if (!is_supported_cluster_size(cluster_size))
+        return nullptr;
+
+    std::string fix_path = Path::fix_path(file_path);
+    Scene* scene = new Scene();
+    scene->cluster_size = cluster_size;
+
+    cgltf_options options = {static_cast<cgltf_file_type>(0)};
+    cgltf_data* data = nullptr;
+    if (cgltf_parse_file(&options, fix_path.c_str(), &data) != cgltf_result_success)
+    {
+        cgltf_free(data);
+        return nullptr;
+    }
+
+    if (cgltf_load_buffers(&options, data, fix_path.c_str()) != cgltf_result_success)
+    {
+        cgltf_free(data);
+        return nullptr;
+    }
+
+    if (cgltf_validate(data) != cgltf_result_success)
+    {
+        cgltf_free(data);
+        return nullptr;
+    }
+
+    // Image paths are relative to the glTF file
+    std::string directory = fix_path.substr(0, fix_path.find_last_of("/\\") + 1);
+    for (size_t i = 0; i < data->images_count; ++i)
+    {
+        const char* uri = data->images[i].uri;
+        bool external = uri && strncmp(uri, "data:", 5) != 0;
+        scene->textures.push_back(external ? directory + uri : std::string());
+    }
+
+    // glTF material i is scene material i + 1
+    scene->materials.push_back(Material());
+    for (size_t i = 0; i < data->materials_count; ++i)
+    {
+        scene->materials.push_back(import_material(&data->materials[i], data));
+    }
+
+    std::vector<glm::mat4> transforms;
+    std::vector<MeshConstants> mesh_constants_list;
+    std::vector<float> total_position_data;
+    std::vector<float> total_normal_data;
+    std::vector<float> total_uv_data;
+    std::vector<uint32_t> total_index_data;
+    uint32_t thread_count = get_worker_thread_count(0);
+    for (size_t i = 0; i < data->nodes_count; ++i)
+    {
+        cgltf_node* cnode = &data->nodes[i];
+
+        if (cnode->light)
+            import_light(cnode, scene);
+
+        if (!cnode->mesh)
+            continue;
+
+        glm::mat4 transform = get_world_matrix(cnode);
+        cgltf_mesh* cmesh = &data->meshes[i];
+        for (size_t j = 0; j < cmesh->primitives_count; j++)
+        {
+            cgltf_primitive* cprimitive = &cmesh->primitives[j];
+
+            cgltf_attribute* position_attribute = get_gltf_attribute(cprimitive, cgltf_attribute_type_position);
+            cgltf_accessor* position_accessor = position_attribute->data;
+            cgltf_buffer_view* position_view = position_accessor->buffer_view;
+            uint32_t vertex_count = (uint32_t)position_accessor->count;
+            float* position_data = (float*)((uint8_t*)(position_view->buffer->data) + position_accessor->offset + position_view->offset);
+            total_position_data.insert(total_position_data.end(), position_data, position_data + vertex_count * 3);
+
+            cgltf_attribute* normal_attribute = get_gltf_attribute(cprimitive, cgltf_attribute_type_normal);
+            cgltf_accessor* normal_accessor = normal_attribute->data;
+            cgltf_buffer_view* normal_view = normal_accessor->buffer_view;
+            float* normal_data = (float*)((uint8_t*)(normal_view->buffer->data) + normal_accessor->offset + normal_view->offset);
+            total_normal_data.insert(total_normal_data.end(), normal_data, normal_data + vertex_count * 3);
+
+            cgltf_attribute* texcoord_attribute = get_gltf_attribute(cprimitive, cgltf_attribute_type_texcoord);
+            cgltf_accessor* texcoord_accessor = texcoord_attribute->data;
+            cgltf_buffer_view* texcoord_view = texcoord_accessor->buffer_view;
+            float* uv_data = (float*)((uint8_t*)(texcoord_view->buffer->data) + texcoord_accessor->offset + texcoord_view->offset);
+            total_uv_data.insert(total_uv_data.end(), uv_data, uv_data + vertex_count * 2);
+
+            cgltf_accessor* index_accessor = cprimitive->indices;
+            cgltf_buffer_view* index_buffer_view = index_accessor->buffer_view;
+            cgltf_buffer* index_buffer = index_buffer_view->buffer;
+            uint32_t index_count = (uint32_t)index_accessor->count;
+            uint32_t* index_data = nullptr;
+            uint32_t* index_u32_data = nullptr;
+            uint16_t* index_u16_data = nullptr;
+            if (index_accessor->component_type == cgltf_component_type_r_16u)
+            {
+                index_u32_data = new uint32_t[index_count];
+                index_u16_data = (uint16_t*)((uint8_t*)index_buffer->data + index_accessor->offset + index_buffer_view->offset);
+                widen_indices(index_u16_data, index_count, index_u32_data);
+                index_data = index_u32_data;
+            }
+            else if (index_accessor->component_type == cgltf_component_type_r_32u)
+            {
+                index_data = (uint32_t*)((uint8_t*)index_buffer->data + index_accessor->offset + index_buffer_view->offset);
+            }
+
+            total_index_data.insert(total_index_data.end(), index_data, index_data + index_count);
+
+            // Cluster
+            uint32_t triangle_count = index_count / 3;
+            Mesh mesh;
+            build_clusters(position_data, index_data, triangle_count, cluster_size, thread_count, mesh);
+            for (auto& cluster : mesh.clusters)
+            {
+                scene->bounds.merge(cluster.aabb_min);
+                scene->bounds.merge(cluster.aabb_max);
+            }
+            scene->meshs.push_back(mesh);
+
+            MeshConstants mesh_constants{};
+            mesh_constants.face_count = triangle_count;
+            mesh_constants.index_offset = scene->index_count;
+            mesh_constants.material_index = cprimitive->material ? (uint32_t)(cprimitive->material - data->materials) + 1 : 0;
+            mesh_constants_list.push_back(mesh_constants);
+
+            DrawCommand draw_command;
+            draw_command.first_instance = 0;
+            draw_command.instance_count = 1;
+            draw_command.first_index = scene->index_count;
+            draw_command.index_count = index_count;
+            draw_command.vertex_offset = 0;
+            scene->draw_commands.push_back(draw_command);
+            transforms.push_back(transform);
+
+            scene->vertex_count += vertex_count;
+            scene->index_count += index_count;
+
+            if (index_u32_data)
+                delete[] index_u32_data;
+        }
+    }
+    cgltf_free(data);
+
+    scene->positions = std::move(total_position_data);
+    scene->normals = std::move(total_normal_data);
+    scene->uvs = std::move(total_uv_data);
+    scene->indices = std::move(total_index_data);
+    scene->mesh_constants = std::move(mesh_constants_list);
+    return scene;
+}
\ No newline at end of file
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "scene.h"
+#include <cstdint>
+#include <string>
+
+struct cgltf_node;
+
+// cluster_size must be one of 64, 128 or 256, the GPU filtering has a shader variant for each
+Scene* load_scene(const std::string& file_path, uint32_t cluster_size = CLUSTER_SIZE);
+
+bool is_supported_cluster_size(uint32_t cluster_size);
+
+// Scatters count point and spot lights over the scene bounds, deterministic for a seed. For scenes
+// shipped without lights.
+void add_random_lights(Scene* scene, uint32_t count, uint32_t seed = 0);
+
+// Importer kernels, exposed for the microbenchmarks
+
+glm::mat4 get_world_matrix(cgltf_node* node);
+
+void widen_indices(const uint16_t* src, uint32_t index_count, uint32_t* dst);
+
+// Bounding box and backface culling cone of every cluster_size triangles
+void build_clusters(const float* position_data, const uint32_t* index_data, uint32_t triangle_count, uint32_t cluster_size, uint32_t thread_count, Mesh& mesh);
@@ -0,0 +1,83 @@
+#include "shadow_cascades.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <cmath>
+
+void compute_shadow_cascades(const glm::mat4& inv_view_proj_matrix, float near, float shadow_distance, const glm::vec3& light_direction,
+                             const BoundingBox& scene_bounds, uint32_t resolution, ShadowCascade cascades[SHADOW_CASCADE_COUNT])
+{
+    glm::vec3 direction = glm::normalize(light_direction);
+    glm::vec3 up = std::abs(direction.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+    // Rotation only, depth along the light is dot(p, direction)
+    glm::mat4 light_view_matrix = glm::lookAt(glm::vec3(0.0f), direction, up);
+
+    // Nearest depth of any caster, the scene bounds may be empty
+    float caster_depth = INFINITY;
+    if (scene_bounds.bb_min.x <= scene_bounds.bb_max.x)
+    {
+        for (int i = 0; i < 8; ++i)
+        {
+            glm::vec3 corner((i & 1) ? scene_bounds.bb_max.x : scene_bounds.bb_min.x,
+                             (i & 2) ? scene_bounds.bb_max.y : scene_bounds.bb_min.y,
+                             (i & 4) ? scene_bounds.bb_max.z : scene_bounds.bb_min.z);
+            caster_depth = glm::min(caster_depth, glm::dot(corner, direction));
+        }
+    }
+
+    float split_near = near;
+    for (uint32_t cascade = 0; cascade < SHADOW_CASCADE_COUNT; ++cascade)
+    {
+        float t = (float)(cascade + 1) / (float)SHADOW_CASCADE_COUNT;
+        float uniform_split = near + (shadow_distance - near) * t;
+        float log_split = near * std::pow(shadow_distance / near, t);
+        float split_far = glm::mix(uniform_split, log_split, SHADOW_SPLIT_LAMBDA);
+
+        // Reversed-Z with an infinite far plane, view distance d is at depth near / d
+        glm::vec3 corners[8];
+        glm::vec3 center = glm::vec3(0.0f);
+        for (int i = 0; i < 8; ++i)
+        {
+            float depth = near / ((i & 4) ? split_far : split_near);
+            glm::vec4 corner = inv_view_proj_matrix * glm::vec4((i & 1) ? 1.0f : -1.0f, (i & 2) ? 1.0f : -1.0f, depth, 1.0f);
+            corners[i] = glm::vec3(corner) / corner.w;
+            center = center + corners[i];
+        }
+        center = center / 8.0f;
+
+        // The sphere does not change size with the camera rotation, unlike a fitted box
+        float radius = 0.0f;
+        for (int i = 0; i < 8; ++i)
+        {
+            radius = glm::max(radius, glm::length(corners[i] - center));
+        }
+        radius = std::ceil(radius * 16.0f) / 16.0f;
+
+        float texel_size = 2.0f * radius / (float)resolution;
+        glm::vec3 light_center = glm::vec3(light_view_matrix * glm::vec4(center, 1.0f));
+        light_center.x = std::floor(light_center.x / texel_size) * texel_size;
+        light_center.y = std::floor(light_center.y / texel_size) * texel_size;
+
+        float center_depth = -light_center.z;
+        float depth_near = glm::min(center_depth - radius, caster_depth);
+        float depth_far = center_depth + radius;
+
+        glm::mat4 proj_matrix = glm::mat4(1.0f);
+        proj_matrix[0][0] = 1.0f / radius;
+        proj_matrix[1][1] = 1.0f / radius;
+        proj_matrix[3][0] = -light_center.x / radius;
+        proj_matrix[3][1] = -light_center.y / radius;
+        // View z is -depth, maps depth_near to 1 and depth_far to 0
+        proj_matrix[2][2] = 1.0f / (depth_far - depth_near);
+        proj_matrix[3][2] = depth_far / (depth_far - depth_near);
+
+        ShadowCascade& result = cascades[cascade];
+        result.view_proj_matrix = proj_matrix * light_view_matrix;
+        result.split_distance = split_far;
+        result.texel_size = texel_size;
+        result.culling_view.view_proj_matrix = result.view_proj_matrix;
+        result.culling_view.position = center - direction * radius;
+        result.culling_view.direction = direction;
+        result.culling_view.orthographic = true;
+
+        split_near = split_far;
+    }
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "cluster_culling.h"
+#include <glm/glm.hpp>
+#include <math/bounding_box.h>
+
+#define SHADOW_CASCADE_COUNT 4
+// Blend between uniform (0) and logarithmic (1) split distances
+#define SHADOW_SPLIT_LAMBDA 0.8f
+
+// One orthographic cascade of a directional light, reversed-Z like the main view: depth is 1
+// nearest to the light. Covers the view distances up to split_distance.
+struct ShadowCascade
+{
+    glm::mat4 view_proj_matrix;
+    float split_distance;
+    // World size of one shadow map texel
+    float texel_size;
+    CullingView culling_view;
+};
+
+// Fits every cascade around a bounding sphere of its slice of the camera frustum, snapped to whole
+// texels so the shadows do not shimmer while the camera moves. Depth extends toward the light up to
+// the scene bounds so every caster in front of the slice is kept.
+void compute_shadow_cascades(const glm::mat4& inv_view_proj_matrix, float near, float shadow_distance, const glm::vec3& light_direction,
+                             const BoundingBox& scene_bounds, uint32_t resolution, ShadowCascade cascades[SHADOW_CASCADE_COUNT]);
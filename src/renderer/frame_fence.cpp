@@ -0,0 +1,51 @@
+#include "frame_fence.h"
+
+FrameFence::FrameFence(uint32_t frame_count)
+{
+    _slots.resize(frame_count);
+    for (auto& slot : _slots)
+    {
+        ez_create_query_pool(1, VK_QUERY_TYPE_TIMESTAMP, slot.query_pool);
+    }
+}
+
+FrameFence::~FrameFence()
+{
+    for (auto& slot : _slots)
+    {
+        ez_destroy_query_pool(slot.query_pool);
+    }
+}
+
+void FrameFence::signal(uint32_t frame_index)
+{
+    Slot& slot = _slots[frame_index % _slots.size()];
+    ez_reset_query_pool(slot.query_pool, 0, 1);
+    ez_write_timestamp(slot.query_pool, 0);
+    slot.pending = true;
+}
+
+void FrameFence::wait(uint32_t frame_index)
+{
+    Slot& slot = _slots[frame_index % _slots.size()];
+    if (!slot.pending)
+        return;
+
+    uint64_t timestamp = 0;
+    ez_get_query_pool_results(slot.query_pool, 0, 1, sizeof(uint64_t), &timestamp, sizeof(uint64_t),
+                              VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT);
+    slot.pending = false;
+}
+
+bool FrameFence::is_signaled(uint32_t frame_index)
+{
+    Slot& slot = _slots[frame_index % _slots.size()];
+    if (!slot.pending)
+        return true;
+
+    uint64_t results[2] = {};
+    ez_get_query_pool_results(slot.query_pool, 0, 1, sizeof(results), results, sizeof(results),
+                              VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+    slot.pending = results[1] == 0;
+    return !slot.pending;
+}
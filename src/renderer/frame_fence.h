@@ -0,0 +1,33 @@
+#pragma once
+
+#include <rhi/ez_vulkan.h>
+#include <vector>
+
+// Completion of the frames in flight. The submit fences stay inside ez, so every frame ends with
+// a timestamp, written only once all previously recorded commands have completed. Waiting on the
+// query of a slot blocks until the last frame that used the slot has finished on the GPU, whatever
+// depth ez pipelines its submits to. Signaled frames have to be submitted before they are waited on.
+class FrameFence
+{
+public:
+    FrameFence(uint32_t frame_count);
+
+    ~FrameFence();
+
+    // After the last command of the frame
+    void signal(uint32_t frame_index);
+
+    // Blocks until the frame last signaled with frame_index has completed, returns at once after that
+    void wait(uint32_t frame_index);
+
+    bool is_signaled(uint32_t frame_index);
+
+private:
+    struct Slot
+    {
+        EzQueryPool query_pool = VK_NULL_HANDLE;
+        bool pending = false;
+    };
+
+    std::vector<Slot> _slots;
+};
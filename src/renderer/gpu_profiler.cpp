@@ -0,0 +1,163 @@
+#include "gpu_profiler.h"
+
+#define SMOOTHING_FACTOR 0.1
+#define PIPELINE_STATISTICS_COUNT 6
+
+static const VkQueryPipelineStatisticFlags PIPELINE_STATISTICS_FLAGS =
+    VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_PRIMITIVES_BIT |
+    VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT |
+    VK_QUERY_PIPELINE_STATISTIC_CLIPPING_INVOCATIONS_BIT |
+    VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT |
+    VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT |
+    VK_QUERY_PIPELINE_STATISTIC_COMPUTE_SHADER_INVOCATIONS_BIT;
+
+GpuProfiler::GpuProfiler(uint32_t frame_count)
+{
+    // Nanoseconds per tick
+    _timestamp_period = (double)ez_get_timestamp_period();
+
+    _frames.resize(frame_count);
+    for (auto& frame_queries : _frames)
+    {
+        ez_create_query_pool(MAX_GPU_TIMESTAMP_COUNT, VK_QUERY_TYPE_TIMESTAMP, frame_queries.query_pool);
+        ez_create_query_pool(MAX_GPU_PIPELINE_STATISTICS_COUNT, VK_QUERY_TYPE_PIPELINE_STATISTICS, frame_queries.statistics_query_pool, PIPELINE_STATISTICS_FLAGS);
+    }
+}
+
+GpuProfiler::~GpuProfiler()
+{
+    for (auto& frame_queries : _frames)
+    {
+        ez_destroy_query_pool(frame_queries.query_pool);
+        ez_destroy_query_pool(frame_queries.statistics_query_pool);
+    }
+}
+
+void GpuProfiler::begin_frame(uint32_t frame_index)
+{
+    _current_frame = &_frames[frame_index % _frames.size()];
+    resolve(*_current_frame);
+    resolve_statistics(*_current_frame);
+
+    ez_reset_query_pool(_current_frame->query_pool, 0, MAX_GPU_TIMESTAMP_COUNT);
+    _current_frame->pass_names.clear();
+    _current_frame->query_count = 0;
+
+    ez_reset_query_pool(_current_frame->statistics_query_pool, 0, MAX_GPU_PIPELINE_STATISTICS_COUNT);
+    _current_frame->statistics_names.clear();
+    _current_frame->statistics_active = false;
+}
+
+void GpuProfiler::begin_pass(const std::string& name)
+{
+    if (!_current_frame || _current_frame->query_count + 2 > MAX_GPU_TIMESTAMP_COUNT)
+        return;
+
+    _current_frame->pass_names.push_back(name);
+    ez_write_timestamp(_current_frame->query_pool, _current_frame->query_count++);
+}
+
+void GpuProfiler::end_pass()
+{
+    if (!_current_frame || _current_frame->query_count % 2 == 0)
+        return;
+
+    ez_write_timestamp(_current_frame->query_pool, _current_frame->query_count++);
+}
+
+void GpuProfiler::begin_statistics(const std::string& name)
+{
+    if (!_current_frame || _current_frame->statistics_active || _current_frame->statistics_names.size() >= MAX_GPU_PIPELINE_STATISTICS_COUNT)
+        return;
+
+    ez_begin_query(_current_frame->statistics_query_pool, (uint32_t)_current_frame->statistics_names.size());
+    _current_frame->statistics_names.push_back(name);
+    _current_frame->statistics_active = true;
+}
+
+void GpuProfiler::end_statistics()
+{
+    if (!_current_frame || !_current_frame->statistics_active)
+        return;
+
+    ez_end_query(_current_frame->statistics_query_pool, (uint32_t)_current_frame->statistics_names.size() - 1);
+    _current_frame->statistics_active = false;
+}
+
+void GpuProfiler::resolve(FrameQueries& frame_queries)
+{
+    _resolved_timings.clear();
+    _resolved_frame_time = 0.0;
+    if (frame_queries.query_count == 0)
+        return;
+
+    // Value and availability per query, unavailable results are dropped instead of waited on
+    std::vector<uint64_t> results(frame_queries.query_count * 2);
+    ez_get_query_pool_results(frame_queries.query_pool, 0, frame_queries.query_count,
+                              (uint32_t)(results.size() * sizeof(uint64_t)), results.data(), sizeof(uint64_t) * 2,
+                              VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+
+    // Passes run in order, so the frame spans the first begin to the last end including the gaps
+    uint32_t last_end = (frame_queries.query_count & ~1u) - 1;
+    if (frame_queries.query_count >= 2 && results[1] != 0 && results[last_end * 2 + 1] != 0 && results[last_end * 2] >= results[0])
+        _resolved_frame_time = (double)(results[last_end * 2] - results[0]) * _timestamp_period / 1000000.0;
+
+    for (uint32_t i = 0; i + 1 < frame_queries.query_count; i += 2)
+    {
+        uint64_t begin = results[i * 2];
+        uint64_t end = results[(i + 1) * 2];
+        bool available = results[i * 2 + 1] != 0 && results[(i + 1) * 2 + 1] != 0;
+        if (!available || end < begin)
+            continue;
+
+        GpuPassTiming timing;
+        timing.name = frame_queries.pass_names[i / 2];
+        timing.gpu_time = (double)(end - begin) * _timestamp_period / 1000000.0;
+        _resolved_timings.push_back(timing);
+
+        bool found = false;
+        for (auto& smoothed_timing : _smoothed_timings)
+        {
+            if (smoothed_timing.name == timing.name)
+            {
+                smoothed_timing.gpu_time += (timing.gpu_time - smoothed_timing.gpu_time) * SMOOTHING_FACTOR;
+                found = true;
+                break;
+            }
+        }
+        if (!found)
+            _smoothed_timings.push_back(timing);
+    }
+}
+
+void GpuProfiler::resolve_statistics(FrameQueries& frame_queries)
+{
+    _resolved_statistics.clear();
+    uint32_t query_count = (uint32_t)frame_queries.statistics_names.size();
+    if (query_count == 0)
+        return;
+
+    // Counters in flag bit order followed by the availability
+    uint32_t stride = PIPELINE_STATISTICS_COUNT + 1;
+    std::vector<uint64_t> results(query_count * stride);
+    ez_get_query_pool_results(frame_queries.statistics_query_pool, 0, query_count,
+                              (uint32_t)(results.size() * sizeof(uint64_t)), results.data(), sizeof(uint64_t) * stride,
+                              VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+
+    for (uint32_t i = 0; i < query_count; ++i)
+    {
+        const uint64_t* result = &results[i * stride];
+        if (result[PIPELINE_STATISTICS_COUNT] == 0)
+            continue;
+
+        GpuPipelineStatistics statistics;
+        statistics.name = frame_queries.statistics_names[i];
+        statistics.input_assembly_primitives = result[0];
+        statistics.vertex_shader_invocations = result[1];
+        statistics.clipping_invocations = result[2];
+        statistics.clipping_primitives = result[3];
+        statistics.fragment_shader_invocations = result[4];
+        statistics.compute_shader_invocations = result[5];
+        _resolved_statistics.push_back(statistics);
+    }
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <rhi/ez_vulkan.h>
+#include <string>
+#include <vector>
+
+#define MAX_GPU_TIMESTAMP_COUNT 128
+#define MAX_GPU_PIPELINE_STATISTICS_COUNT 16
+
+struct GpuPassTiming
+{
+    std::string name;
+    // Milliseconds
+    double gpu_time;
+};
+
+struct GpuPipelineStatistics
+{
+    std::string name;
+    uint64_t input_assembly_primitives;
+    uint64_t vertex_shader_invocations;
+    uint64_t clipping_invocations;
+    uint64_t clipping_primitives;
+    uint64_t fragment_shader_invocations;
+    uint64_t compute_shader_invocations;
+};
+
+// Timestamp queries around every render graph pass. Each frame in flight owns a query pool
+// which is only read back once the ring wraps around, so results are a few frames late but
+// never stall the CPU.
+class GpuProfiler
+{
+public:
+    GpuProfiler(uint32_t frame_count);
+
+    ~GpuProfiler();
+
+    void begin_frame(uint32_t frame_index);
+
+    void begin_pass(const std::string& name);
+
+    void end_pass();
+
+    // Pipeline statistics queries, only for the passes that ask for them
+    void begin_statistics(const std::string& name);
+
+    void end_statistics();
+
+    // Timings of the frame that was read back in the last begin_frame, empty if not available yet
+    const std::vector<GpuPassTiming>& get_resolved_timings() const { return _resolved_timings; }
+
+    // Milliseconds from the first to the last timestamp of the same frame, 0 if not available yet
+    double get_resolved_frame_time() const { return _resolved_frame_time; }
+
+    // Exponential moving average of every pass seen so far
+    const std::vector<GpuPassTiming>& get_smoothed_timings() const { return _smoothed_timings; }
+
+    const std::vector<GpuPipelineStatistics>& get_resolved_statistics() const { return _resolved_statistics; }
+
+private:
+    struct FrameQueries
+    {
+        EzQueryPool query_pool = VK_NULL_HANDLE;
+        std::vector<std::string> pass_names;
+        uint32_t query_count = 0;
+        EzQueryPool statistics_query_pool = VK_NULL_HANDLE;
+        std::vector<std::string> statistics_names;
+        bool statistics_active = false;
+    };
+
+    void resolve(FrameQueries& frame_queries);
+
+    void resolve_statistics(FrameQueries& frame_queries);
+
+    std::vector<FrameQueries> _frames;
+    FrameQueries* _current_frame = nullptr;
+    double _timestamp_period = 1.0;
+    std::vector<GpuPassTiming> _resolved_timings;
+    double _resolved_frame_time = 0.0;
+    std::vector<GpuPassTiming> _smoothed_timings;
+    std::vector<GpuPipelineStatistics> _resolved_statistics;
+};
@@ -0,0 +1,98 @@
+#include "gpu_scene.h"
+#include "scene.h"
+#include "cpu_profiler.h"
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+static_assert(sizeof(DrawCommand) == sizeof(VkDrawIndexedIndirectCommand), "DrawCommand must match VkDrawIndexedIndirectCommand");
+static_assert(sizeof(Light) == 64, "Light must match the std430 layout in shader_defs.glsl");
+static_assert(sizeof(MaterialConstants) <= MATERIAL_BUFFER_STRIDE, "MaterialConstants must fit in its uniform range");
+
+static EzBuffer create_rw_buffer(const void* data, uint32_t data_size, VkBufferUsageFlags usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT)
+{
+    EzBuffer buffer;
+    EzBufferDesc buffer_desc = {};
+    buffer_desc.size = data_size;
+    buffer_desc.usage = usage | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+    buffer_desc.memory_flags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+    ez_create_buffer(buffer_desc, buffer);
+
+    VkBufferMemoryBarrier2 barrier;
+    if (data)
+    {
+        barrier = ez_buffer_barrier(buffer, EZ_RESOURCE_STATE_COPY_DEST);
+        ez_pipeline_barrier(0, 1, &barrier, 0, nullptr);
+        ez_update_buffer(buffer, data_size, 0, (void*)data);
+    }
+
+    EzResourceState flag = EZ_RESOURCE_STATE_UNDEFINED;
+    if ((usage & VK_BUFFER_USAGE_VERTEX_BUFFER_BIT) != 0)
+        flag |= EZ_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER;
+    if ((usage & VK_BUFFER_USAGE_INDEX_BUFFER_BIT) != 0)
+        flag |= EZ_RESOURCE_STATE_INDEX_BUFFER;
+    if ((usage & VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT) != 0)
+        flag |= EZ_RESOURCE_STATE_INDIRECT_ARGUMENT;
+    barrier = ez_buffer_barrier(buffer, EZ_RESOURCE_STATE_SHADER_RESOURCE | EZ_RESOURCE_STATE_UNORDERED_ACCESS | flag);
+    ez_pipeline_barrier(0, 1, &barrier, 0, nullptr);
+
+    return buffer;
+}
+
+GpuScene::GpuScene(Scene* scene)
+{
+    PROFILE_SCOPE("upload_scene_buffers");
+
+    position_buffer = create_rw_buffer(scene->positions.data(), scene->positions.size() * sizeof(float), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+    normal_buffer = create_rw_buffer(scene->normals.data(), scene->normals.size() * sizeof(float), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+    uv_buffer = create_rw_buffer(scene->uvs.data(), scene->uvs.size() * sizeof(float), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+    index_buffer = create_rw_buffer(scene->indices.data(), scene->indices.size() * sizeof(uint32_t), VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
+    filtered_index_buffer = create_rw_buffer(nullptr, scene->indices.size() * sizeof(uint32_t), VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
+    mesh_constants_buffer = create_rw_buffer(scene->mesh_constants.data(), scene->mesh_constants.size() * sizeof(MeshConstants));
+    draw_command_buffer = create_rw_buffer(scene->draw_commands.data(), scene->draw_commands.size() * sizeof(DrawCommand), VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT);
+    if (scene->lights.empty())
+        light_buffer = create_rw_buffer(nullptr, sizeof(Light));
+    else
+        light_buffer = create_rw_buffer(scene->lights.data(), scene->lights.size() * sizeof(Light));
+
+    // Scenes built by hand may have no material, they get the default one
+    material_count = std::max(1u, std::min((uint32_t)scene->materials.size(), (uint32_t)MAX_MATERIALS));
+    std::vector<uint8_t> material_data(material_count * MATERIAL_BUFFER_STRIDE, 0);
+    for (uint32_t i = 0; i < material_count; ++i)
+    {
+        Material material = i < scene->materials.size() ? scene->materials[i] : Material();
+        MaterialConstants constants{};
+        constants.base_color = material.base_color_factor;
+        constants.emissive = glm::vec4(material.emissive_factor, 0.0f);
+        constants.metallic = material.metallic_factor;
+        constants.roughness = material.roughness_factor;
+        constants.index = i;
+        memcpy(material_data.data() + i * MATERIAL_BUFFER_STRIDE, &constants, sizeof(MaterialConstants));
+    }
+    material_buffer = create_rw_buffer(material_data.data(), (uint32_t)material_data.size(), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT);
+}
+
+GpuScene::~GpuScene()
+{
+    ez_destroy_buffer(position_buffer);
+    ez_destroy_buffer(normal_buffer);
+    ez_destroy_buffer(uv_buffer);
+    ez_destroy_buffer(index_buffer);
+    ez_destroy_buffer(filtered_index_buffer);
+    ez_destroy_buffer(mesh_constants_buffer);
+    ez_destroy_buffer(draw_command_buffer);
+    ez_destroy_buffer(light_buffer);
+    ez_destroy_buffer(material_buffer);
+}
+
+uint64_t GpuScene::get_gpu_memory_size() const
+{
+    uint64_t size = 0;
+    EzBuffer buffers[] = {position_buffer, normal_buffer, uv_buffer, index_buffer, filtered_index_buffer, mesh_constants_buffer, draw_command_buffer, light_buffer, material_buffer};
+    for (auto buffer : buffers)
+    {
+        if (buffer)
+            size += buffer->size;
+    }
+    return size;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <rhi/ez_vulkan.h>
+#include <glm/glm.hpp>
+
+// Keep in sync with shader_defs.glsl
+#define MAX_MATERIALS 1024
+// Every material is bound as its own uniform range, 256 meets any offset alignment
+#define MATERIAL_BUFFER_STRIDE 256
+
+class Scene;
+
+// Keep in sync with MaterialConstants in shader_defs.glsl (std140)
+struct MaterialConstants
+{
+    glm::vec4 base_color;
+    glm::vec4 emissive;
+    float metallic;
+    float roughness;
+    uint32_t index;
+    uint32_t padding;
+};
+
+// GPU copies of the scene streams, created by the renderer when the scene changes
+class GpuScene
+{
+public:
+    GpuScene(Scene* scene);
+
+    ~GpuScene();
+
+    uint64_t get_gpu_memory_size() const;
+
+    EzBuffer position_buffer = VK_NULL_HANDLE;
+    EzBuffer normal_buffer = VK_NULL_HANDLE;
+    EzBuffer uv_buffer = VK_NULL_HANDLE;
+    EzBuffer index_buffer = VK_NULL_HANDLE;
+    EzBuffer filtered_index_buffer = VK_NULL_HANDLE;
+    EzBuffer mesh_constants_buffer = VK_NULL_HANDLE;
+    EzBuffer draw_command_buffer = VK_NULL_HANDLE;
+    // Never empty, holds one unused light when the scene has none
+    EzBuffer light_buffer = VK_NULL_HANDLE;
+    // MATERIAL_BUFFER_STRIDE bytes per material, at most MAX_MATERIALS, the rest shade as the last one
+    EzBuffer material_buffer = VK_NULL_HANDLE;
+    uint32_t material_count = 0;
+};
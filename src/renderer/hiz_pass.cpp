@@ -0,0 +1,116 @@
+#include "hiz_pass.h"
+#include "renderer.h"
+#include "render_graph.h"
+#include "shader_library.h"
+#include <algorithm>
+
+HiZPass::HiZPass(Renderer* renderer)
+{
+    _renderer = renderer;
+
+    EzSamplerDesc sampler_desc{};
+    sampler_desc.address_u = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    sampler_desc.address_v = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    sampler_desc.address_w = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    ez_create_sampler(sampler_desc, _sampler);
+
+    _downsample_depth_shader = get_shader("hiz_downsample_depth.comp");
+    _downsample_shader = get_shader("hiz_downsample.comp");
+}
+
+HiZPass::~HiZPass()
+{
+    ez_destroy_sampler(_sampler);
+    if (_hiz_texture)
+        ez_destroy_texture(_hiz_texture);
+}
+
+void HiZPass::update_hiz_texture()
+{
+    uint32_t width = std::max(1u, _renderer->_width / 2);
+    uint32_t height = std::max(1u, _renderer->_height / 2);
+    if (_hiz_texture && _hiz_texture->width == width && _hiz_texture->height == height)
+        return;
+
+    if (_hiz_texture)
+        ez_destroy_texture(_hiz_texture);
+
+    _mip_count = 1;
+    while ((std::max(width, height) >> _mip_count) > 0)
+        _mip_count++;
+
+    EzTextureDesc desc{};
+    desc.width = width;
+    desc.height = height;
+    desc.levels = _mip_count;
+    desc.format = VK_FORMAT_R32G32_SFLOAT;
+    desc.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT;
+    ez_create_texture(desc, _hiz_texture);
+    ez_create_texture_view(_hiz_texture, VK_IMAGE_VIEW_TYPE_2D, VK_IMAGE_ASPECT_COLOR_BIT, 0, _mip_count, 0, 1);
+    for (uint32_t mip = 0; mip < _mip_count; ++mip)
+    {
+        ez_create_texture_view(_hiz_texture, VK_IMAGE_VIEW_TYPE_2D, VK_IMAGE_ASPECT_COLOR_BIT, mip, 1, 0, 1);
+    }
+}
+
+void HiZPass::setup(RenderGraph* graph)
+{
+    update_hiz_texture();
+    _renderer->_hiz_rt = graph->import_texture(_hiz_texture);
+
+    // The depth buffer is kept as well, the pyramid of the frame it came from still holds
+    if (_renderer->_reuse_visibility_buffer)
+        return;
+
+    graph->add_pass("hiz_pyramid")
+        .read(_renderer->_depth_rt, EZ_RESOURCE_STATE_SHADER_RESOURCE)
+        .write(_renderer->_hiz_rt, EZ_RESOURCE_STATE_UNORDERED_ACCESS)
+        .set_execute([this]() { render(); });
+}
+
+uint64_t HiZPass::get_gpu_memory_size() const
+{
+    if (!_hiz_texture)
+        return 0;
+
+    // Two floats per texel, the mip chain adds at most a third
+    uint64_t size = 0;
+    for (uint32_t mip = 0; mip < _mip_count; ++mip)
+    {
+        uint64_t width = std::max(1u, _hiz_texture->width >> mip);
+        uint64_t height = std::max(1u, _hiz_texture->height >> mip);
+        size += width * height * 8;
+    }
+    return size;
+}
+
+void HiZPass::render()
+{
+    EzTexture depth_rt = _renderer->_graph->get_texture(_renderer->_depth_rt);
+
+    ez_reset_pipeline_state();
+
+    for (uint32_t mip = 0; mip < _mip_count; ++mip)
+    {
+        if (mip == 0)
+        {
+            ez_bind_texture(0, depth_rt, 0);
+            ez_bind_sampler(1, _sampler);
+            ez_set_compute_shader(_downsample_depth_shader);
+        }
+        else
+        {
+            // Mip - 1 was written by the previous dispatch
+            VkImageMemoryBarrier2 barrier = ez_image_barrier(_hiz_texture, EZ_RESOURCE_STATE_UNORDERED_ACCESS);
+            ez_pipeline_barrier(0, 0, nullptr, 1, &barrier);
+
+            ez_bind_texture(0, _hiz_texture, mip);
+            ez_set_compute_shader(_downsample_shader);
+        }
+        ez_bind_texture(2, _hiz_texture, mip + 1);
+
+        uint32_t width = std::max(1u, _hiz_texture->width >> mip);
+        uint32_t height = std::max(1u, _hiz_texture->height >> mip);
+        ez_dispatch((width + 7) / 8, (height + 7) / 8, 1);
+    }
+}
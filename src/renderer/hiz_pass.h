@@ -0,0 +1,34 @@
+#pragma once
+#include <rhi/ez_vulkan.h>
+
+class Renderer;
+class RenderGraph;
+
+// Min/max depth pyramid of the visibility buffer pass depth, R32G32_SFLOAT with x the farthest
+// and y the nearest depth. Mip 0 is half the render resolution. View 0 spans the whole chain for
+// sampling, view 1 + i is mip i alone. Culled by the render graph until a pass reads _hiz_rt.
+class HiZPass
+{
+public:
+    HiZPass(Renderer* renderer);
+
+    ~HiZPass();
+
+    void setup(RenderGraph* graph);
+
+    uint32_t get_mip_count() const { return _mip_count; }
+
+    uint64_t get_gpu_memory_size() const;
+
+private:
+    void update_hiz_texture();
+
+    void render();
+
+    Renderer* _renderer;
+    EzTexture _hiz_texture = VK_NULL_HANDLE;
+    uint32_t _mip_count = 0;
+    EzSampler _sampler = VK_NULL_HANDLE;
+    EzShader _downsample_depth_shader = VK_NULL_HANDLE;
+    EzShader _downsample_shader = VK_NULL_HANDLE;
+};
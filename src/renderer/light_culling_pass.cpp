@@ -0,0 +1,102 @@
+#include "light_culling_pass.h"
+#include "renderer.h"
+#include "gpu_scene.h"
+#include "render_graph.h"
+#include "shader_library.h"
+
+LightCullingPass::LightCullingPass(Renderer* renderer)
+{
+    _renderer = renderer;
+
+    EzSamplerDesc sampler_desc{};
+    sampler_desc.address_u = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    sampler_desc.address_v = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    sampler_desc.address_w = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    ez_create_sampler(sampler_desc, _sampler);
+
+    _light_culling_shader = get_shader("light_culling.comp");
+}
+
+LightCullingPass::~LightCullingPass()
+{
+    ez_destroy_sampler(_sampler);
+    if (_light_grid_buffer)
+        ez_destroy_buffer(_light_grid_buffer);
+    if (_light_index_buffer)
+        ez_destroy_buffer(_light_index_buffer);
+}
+
+void LightCullingPass::update_tile_buffers()
+{
+    uint32_t tile_count_x = (_renderer->_width + SCREEN_TILE_SIZE - 1) / SCREEN_TILE_SIZE;
+    uint32_t tile_count_y = (_renderer->_height + SCREEN_TILE_SIZE - 1) / SCREEN_TILE_SIZE;
+    if (_light_grid_buffer && tile_count_x == _tile_count_x && tile_count_y == _tile_count_y)
+        return;
+
+    if (_light_grid_buffer)
+    {
+        _renderer->_graph->release_buffer(_light_grid_buffer);
+        ez_destroy_buffer(_light_grid_buffer);
+    }
+    if (_light_index_buffer)
+    {
+        _renderer->_graph->release_buffer(_light_index_buffer);
+        ez_destroy_buffer(_light_index_buffer);
+    }
+
+    _tile_count_x = tile_count_x;
+    _tile_count_y = tile_count_y;
+
+    EzBufferDesc buffer_desc{};
+    buffer_desc.size = sizeof(uint32_t) * tile_count_x * tile_count_y;
+    buffer_desc.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+    buffer_desc.memory_flags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+    ez_create_buffer(buffer_desc, _light_grid_buffer);
+
+    buffer_desc.size *= MAX_LIGHTS_PER_TILE;
+    ez_create_buffer(buffer_desc, _light_index_buffer);
+}
+
+void LightCullingPass::setup(RenderGraph* graph)
+{
+    update_tile_buffers();
+
+    // Depth, view and lights are unchanged, the lists of the frame the visibility buffer came from still hold
+    if (_renderer->_reuse_visibility_buffer)
+        return;
+
+    graph->add_pass("light_culling")
+        .read(_renderer->_depth_rt, EZ_RESOURCE_STATE_SHADER_RESOURCE)
+        .read(_renderer->_gpu_scene->light_buffer, EZ_RESOURCE_STATE_SHADER_RESOURCE)
+        .write(_light_grid_buffer, EZ_RESOURCE_STATE_UNORDERED_ACCESS)
+        .write(_light_index_buffer, EZ_RESOURCE_STATE_UNORDERED_ACCESS)
+        .set_execute([this]() { render(); });
+}
+
+void LightCullingPass::render()
+{
+    EzTexture depth_rt = _renderer->_graph->get_texture(_renderer->_depth_rt);
+    EzBuffer view_buffer = _renderer->get_view_buffer();
+    EzBuffer light_buffer = _renderer->_gpu_scene->light_buffer;
+
+    ez_reset_pipeline_state();
+
+    ez_bind_texture(0, depth_rt, 0);
+    ez_bind_sampler(1, _sampler);
+    ez_bind_buffer(2, view_buffer, view_buffer->size);
+    ez_bind_buffer(3, light_buffer, light_buffer->size);
+    ez_bind_buffer(4, _light_grid_buffer, _light_grid_buffer->size);
+    ez_bind_buffer(5, _light_index_buffer, _light_index_buffer->size);
+    ez_set_compute_shader(_light_culling_shader);
+    ez_dispatch(_tile_count_x, _tile_count_y, 1);
+}
+
+uint64_t LightCullingPass::get_gpu_memory_size() const
+{
+    uint64_t size = 0;
+    if (_light_grid_buffer)
+        size += _light_grid_buffer->size;
+    if (_light_index_buffer)
+        size += _light_index_buffer->size;
+    return size;
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include <rhi/ez_vulkan.h>
+
+// Keep in sync with shader_defs.glsl
+#define MAX_LIGHTS_PER_TILE 128
+
+class Renderer;
+class RenderGraph;
+
+// Tiled light culling from the visibility buffer depth. Lists the point and spot lights reaching
+// each SCREEN_TILE_SIZE tile so the shading only loops over those, lights past MAX_LIGHTS_PER_TILE
+// in one tile are dropped.
+class LightCullingPass
+{
+public:
+    LightCullingPass(Renderer* renderer);
+
+    ~LightCullingPass();
+
+    void setup(RenderGraph* graph);
+
+    // Light count per tile, row major
+    EzBuffer get_light_grid_buffer() const { return _light_grid_buffer; }
+
+    // MAX_LIGHTS_PER_TILE light indices per tile
+    EzBuffer get_light_index_buffer() const { return _light_index_buffer; }
+
+    uint64_t get_gpu_memory_size() const;
+
+private:
+    void update_tile_buffers();
+
+    void render();
+
+    Renderer* _renderer;
+    uint32_t _tile_count_x = 0;
+    uint32_t _tile_count_y = 0;
+    EzBuffer _light_grid_buffer = VK_NULL_HANDLE;
+    EzBuffer _light_index_buffer = VK_NULL_HANDLE;
+    EzSampler _sampler = VK_NULL_HANDLE;
+    EzShader _light_culling_shader = VK_NULL_HANDLE;
+};
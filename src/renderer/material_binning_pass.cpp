@@ -0,0 +1,190 @@
+#include "material_binning_pass.h"
+#include "triangle_filtering_pass.h"
+#include "rsg.h"
+#include "gpu_scene.h"
+#include "render_graph.h"
+#include "shader_library.h"
+
+MaterialBinningPass::MaterialBinningPass(Renderer* renderer)
+{
+    _renderer = renderer;
+
+    EzSamplerDesc sampler_desc{};
+    sampler_desc.address_u = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    sampler_desc.address_v = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    sampler_desc.address_w = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    ez_create_sampler(sampler_desc, _sampler);
+
+    _vertex_shader = get_shader("visibility_buffer_shading_pass.vert");
+    _material_depth_shader = get_shader("material_depth.frag");
+    _classify_shader = get_shader("material_classify.comp");
+
+    EzBufferDesc buffer_desc{};
+    buffer_desc.size = sizeof(VkDrawIndexedIndirectCommand) * MAX_MATERIALS;
+    buffer_desc.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT;
+    buffer_desc.memory_flags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    for (int i = 0; i < FRAMES_IN_FLIGHT; ++i)
+    {
+        ez_create_buffer(buffer_desc, _draw_command_buffers[i]);
+    }
+}
+
+MaterialBinningPass::~MaterialBinningPass()
+{
+    ez_destroy_sampler(_sampler);
+    if (_material_tile_buffer)
+        ez_destroy_buffer(_material_tile_buffer);
+    for (int i = 0; i < FRAMES_IN_FLIGHT; ++i)
+    {
+        ez_destroy_buffer(_draw_command_buffers[i]);
+    }
+}
+
+EzBuffer MaterialBinningPass::get_draw_command_buffer() const
+{
+    return _draw_command_buffers[_renderer->get_frame_index()];
+}
+
+void MaterialBinningPass::update_tile_buffer()
+{
+    uint32_t tile_count_x = (_renderer->_width + SCREEN_TILE_SIZE - 1) / SCREEN_TILE_SIZE;
+    uint32_t tile_count_y = (_renderer->_height + SCREEN_TILE_SIZE - 1) / SCREEN_TILE_SIZE;
+    uint32_t tile_capacity = tile_count_x * tile_count_y;
+    uint32_t material_count = _renderer->_gpu_scene->material_count;
+    if (_material_tile_buffer && tile_capacity == _tile_capacity && material_count == _material_count)
+        return;
+
+    if (_material_tile_buffer)
+    {
+        _renderer->_graph->release_buffer(_material_tile_buffer);
+        ez_destroy_buffer(_material_tile_buffer);
+    }
+
+    _tile_capacity = tile_capacity;
+    _material_count = material_count;
+
+    // Worst case every material covers every tile
+    EzBufferDesc buffer_desc{};
+    buffer_desc.size = sizeof(uint32_t) * tile_capacity * material_count;
+    buffer_desc.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+    buffer_desc.memory_flags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+    ez_create_buffer(buffer_desc, _material_tile_buffer);
+}
+
+void MaterialBinningPass::setup(RenderGraph* graph)
+{
+    update_tile_buffer();
+
+    // Same desc as depth_rt, without temporal reuse it gets depth_rt's texture once the light culling is done with it
+    EzTextureDesc desc = Renderer::get_depth_desc(_renderer->_width, _renderer->_height);
+    _renderer->_material_depth_rt = graph->create_texture("material_depth_rt", desc, VK_IMAGE_ASPECT_DEPTH_BIT);
+
+    // Cheap next to the shading, redone every frame so the bins need no history of their own
+    EzBuffer mesh_constants_buffer = _renderer->_gpu_scene->mesh_constants_buffer;
+    EzBuffer draw_mesh_buffer = _renderer->_triangle_filtering_pass->get_draw_mesh_buffer();
+    graph->add_pass("material_depth")
+        .read(_renderer->_vb_rt, EZ_RESOURCE_STATE_SHADER_RESOURCE)
+        .read(mesh_constants_buffer, EZ_RESOURCE_STATE_SHADER_RESOURCE)
+        .read(draw_mesh_buffer, EZ_RESOURCE_STATE_SHADER_RESOURCE)
+        .write(_renderer->_material_depth_rt, EZ_RESOURCE_STATE_DEPTH_WRITE)
+        .set_execute([this]() { render_material_depth(); });
+
+    graph->add_pass("material_classify")
+        .read(_renderer->_vb_rt, EZ_RESOURCE_STATE_SHADER_RESOURCE)
+        .read(mesh_constants_buffer, EZ_RESOURCE_STATE_SHADER_RESOURCE)
+        .read(draw_mesh_buffer, EZ_RESOURCE_STATE_SHADER_RESOURCE)
+        .write(_material_tile_buffer, EZ_RESOURCE_STATE_UNORDERED_ACCESS)
+        .write(get_draw_command_buffer(), EZ_RESOURCE_STATE_UNORDERED_ACCESS)
+        .set_execute([this]() { classify(); });
+}
+
+void MaterialBinningPass::render_material_depth()
+{
+    RenderGraph* graph = _renderer->_graph;
+    EzBuffer view_buffer = _renderer->get_view_buffer();
+    EzBuffer mesh_constants_buffer = _renderer->_gpu_scene->mesh_constants_buffer;
+    EzBuffer draw_mesh_buffer = _renderer->_triangle_filtering_pass->get_draw_mesh_buffer();
+
+    ez_reset_pipeline_state();
+
+    EzRenderingAttachmentInfo depth_info{};
+    depth_info.texture = graph->get_texture(_renderer->_material_depth_rt);
+    // Matches no material
+    depth_info.clear_value.depthStencil = {0.0f, 0};
+
+    EzRenderingInfo rendering_info{};
+    rendering_info.width = _renderer->_width;
+    rendering_info.height = _renderer->_height;
+    rendering_info.depth.push_back(depth_info);
+    ez_begin_rendering(rendering_info);
+
+    ez_set_viewport(0, 0, (float)_renderer->_width, (float)_renderer->_height);
+    ez_set_scissor(0, 0, (int32_t)_renderer->_width, (int32_t)_renderer->_height);
+
+    ez_set_vertex_shader(_vertex_shader);
+    ez_set_fragment_shader(_material_depth_shader);
+
+    ez_set_vertex_binding(0, 20);
+    ez_set_vertex_attrib(0, 0, VK_FORMAT_R32G32B32_SFLOAT, 0);
+    ez_set_vertex_attrib(0, 1, VK_FORMAT_R32G32_SFLOAT, 12);
+
+    EzDepthState depth_state{};
+    depth_state.depth_test = true;
+    depth_state.depth_write = true;
+    depth_state.depth_func = VK_COMPARE_OP_ALWAYS;
+    ez_set_depth_state(depth_state);
+
+    ez_bind_texture(0, graph->get_texture(_renderer->_vb_rt), 0);
+    ez_bind_sampler(1, _sampler);
+    ez_bind_buffer(2, view_buffer, view_buffer->size);
+    ez_bind_buffer(3, mesh_constants_buffer, mesh_constants_buffer->size);
+    ez_bind_buffer(4, draw_mesh_buffer, draw_mesh_buffer->size);
+
+    ez_set_primitive_topology(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST);
+    ez_bind_vertex_buffer(RSG::quad_buffer);
+    ez_draw(6, 0);
+
+    ez_end_rendering();
+}
+
+void MaterialBinningPass::classify()
+{
+    // Host visible, the frame fence waited for the previous use of this frame's buffer
+    void* mapped_data = nullptr;
+    EzBuffer draw_command_buffer = get_draw_command_buffer();
+    ez_map_memory(draw_command_buffer, &mapped_data);
+    VkDrawIndexedIndirectCommand* draw_commands = (VkDrawIndexedIndirectCommand*)mapped_data;
+    for (uint32_t i = 0; i < _material_count; ++i)
+    {
+        draw_commands[i] = {6, 0, 0, 0, 0};
+    }
+    ez_unmap_memory(draw_command_buffer);
+
+    EzBuffer view_buffer = _renderer->get_view_buffer();
+    EzBuffer mesh_constants_buffer = _renderer->_gpu_scene->mesh_constants_buffer;
+    EzBuffer draw_mesh_buffer = _renderer->_triangle_filtering_pass->get_draw_mesh_buffer();
+
+    ez_reset_pipeline_state();
+
+    ez_bind_texture(0, _renderer->_graph->get_texture(_renderer->_vb_rt), 0);
+    ez_bind_sampler(1, _sampler);
+    ez_bind_buffer(2, view_buffer, view_buffer->size);
+    ez_bind_buffer(3, mesh_constants_buffer, mesh_constants_buffer->size);
+    ez_bind_buffer(4, _material_tile_buffer, _material_tile_buffer->size);
+    ez_bind_buffer(5, draw_command_buffer, draw_command_buffer->size);
+    ez_bind_buffer(6, draw_mesh_buffer, draw_mesh_buffer->size);
+    ez_set_compute_shader(_classify_shader);
+    ez_dispatch((_renderer->_width + SCREEN_TILE_SIZE - 1) / SCREEN_TILE_SIZE, (_renderer->_height + SCREEN_TILE_SIZE - 1) / SCREEN_TILE_SIZE, 1);
+}
+
+uint64_t MaterialBinningPass::get_gpu_memory_size() const
+{
+    uint64_t size = 0;
+    if (_material_tile_buffer)
+        size += _material_tile_buffer->size;
+    for (int i = 0; i < FRAMES_IN_FLIGHT; ++i)
+    {
+        size += _draw_command_buffers[i]->size;
+    }
+    return size;
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include "renderer.h"
+#include <rhi/ez_vulkan.h>
+
+class RenderGraph;
+
+// Sorts the visibility buffer pixels by material for the shading. Writes the material of every
+// pixel as depth into _material_depth_rt and lists the SCREEN_TILE_SIZE tiles every material covers,
+// with one indexed indirect draw of a tile quad per material, instanced once per listed tile.
+class MaterialBinningPass
+{
+public:
+    MaterialBinningPass(Renderer* renderer);
+
+    ~MaterialBinningPass();
+
+    void setup(RenderGraph* graph);
+
+    // One list of tile_count.x * tile_count.y tiles per material
+    EzBuffer get_material_tile_buffer() const { return _material_tile_buffer; }
+
+    // One VkDrawIndexedIndirectCommand per material, of this frame
+    EzBuffer get_draw_command_buffer() const;
+
+    uint64_t get_gpu_memory_size() const;
+
+private:
+    void update_tile_buffer();
+
+    void render_material_depth();
+
+    void classify();
+
+    Renderer* _renderer;
+    uint32_t _tile_capacity = 0;
+    uint32_t _material_count = 0;
+    EzBuffer _material_tile_buffer = VK_NULL_HANDLE;
+    // Per frame in flight, cleared by the host before the classification
+    EzBuffer _draw_command_buffers[FRAMES_IN_FLIGHT] = {};
+    EzSampler _sampler = VK_NULL_HANDLE;
+    EzShader _vertex_shader = VK_NULL_HANDLE;
+    EzShader _material_depth_shader = VK_NULL_HANDLE;
+    EzShader _classify_shader = VK_NULL_HANDLE;
+};
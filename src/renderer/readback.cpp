@@ -0,0 +1,61 @@
+#include "readback.h"
+#include <cstring>
+
+static EzBuffer create_readback_buffer(uint32_t size)
+{
+    EzBufferDesc buffer_desc{};
+    buffer_desc.size = size;
+    buffer_desc.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    buffer_desc.memory_flags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    EzBuffer buffer = VK_NULL_HANDLE;
+    ez_create_buffer(buffer_desc, buffer);
+    return buffer;
+}
+
+static void copy_readback_buffer(EzBuffer buffer, uint32_t size, std::vector<uint8_t>& data)
+{
+    ez_submit();
+    ez_flush();
+
+    data.resize(size);
+    void* mapped_data = nullptr;
+    ez_map_memory(buffer, &mapped_data);
+    memcpy(data.data(), mapped_data, size);
+    ez_unmap_memory(buffer);
+    ez_destroy_buffer(buffer);
+}
+
+void readback_texture(EzTexture texture, VkImageAspectFlags aspect, uint32_t width, uint32_t height, uint32_t texel_size, std::vector<uint8_t>& data)
+{
+    uint32_t size = width * height * texel_size;
+    EzBuffer readback_buffer = create_readback_buffer(size);
+
+    VkImageMemoryBarrier2 image_barrier = ez_image_barrier(texture, EZ_RESOURCE_STATE_COPY_SOURCE);
+    VkBufferMemoryBarrier2 buffer_barrier = ez_buffer_barrier(readback_buffer, EZ_RESOURCE_STATE_COPY_DEST);
+    ez_pipeline_barrier(0, 1, &buffer_barrier, 1, &image_barrier);
+
+    VkBufferImageCopy copy_region = {};
+    copy_region.imageSubresource.aspectMask = aspect;
+    copy_region.imageSubresource.layerCount = 1;
+    copy_region.imageExtent = { width, height, 1 };
+    ez_copy_image_to_buffer(texture, readback_buffer, copy_region);
+
+    copy_readback_buffer(readback_buffer, size, data);
+}
+
+void readback_buffer(EzBuffer buffer, std::vector<uint8_t>& data)
+{
+    uint32_t size = (uint32_t)buffer->size;
+    EzBuffer readback_buffer = create_readback_buffer(size);
+
+    VkBufferMemoryBarrier2 barriers[2];
+    barriers[0] = ez_buffer_barrier(buffer, EZ_RESOURCE_STATE_COPY_SOURCE);
+    barriers[1] = ez_buffer_barrier(readback_buffer, EZ_RESOURCE_STATE_COPY_DEST);
+    ez_pipeline_barrier(0, 2, barriers, 0, nullptr);
+
+    VkBufferCopy copy_region = {};
+    copy_region.size = size;
+    ez_copy_buffer(buffer, readback_buffer, copy_region);
+
+    copy_readback_buffer(readback_buffer, size, data);
+}
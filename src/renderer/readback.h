@@ -0,0 +1,9 @@
+#pragma once
+
+#include <rhi/ez_vulkan.h>
+#include <vector>
+
+// Blocking, waits for every submitted frame, meant for headless captures and tests rather than per frame use
+void readback_texture(EzTexture texture, VkImageAspectFlags aspect, uint32_t width, uint32_t height, uint32_t texel_size, std::vector<uint8_t>& data);
+
+void readback_buffer(EzBuffer buffer, std::vector<uint8_t>& data);
@@ -0,0 +1,542 @@
+#include "render_graph.h"
+#include "gpu_profiler.h"
+#include "cpu_profiler.h"
+#include "frame_fence.h"
+#include <algorithm>
+#include <chrono>
+
+// Tracked states of buffers untouched for longer are dropped, their next access gets a full barrier
+#define RESOURCE_STATE_MAX_AGE 64
+
+static bool contains_state(EzResourceState current, EzResourceState state)
+{
+    return ((uint32_t)current & (uint32_t)state) == (uint32_t)state;
+}
+
+static uint32_t get_format_size(VkFormat format)
+{
+    switch (format)
+    {
+        case VK_FORMAT_R32G32_SFLOAT:
+        case VK_FORMAT_R32G32_UINT:
+        case VK_FORMAT_R16G16B16A16_SFLOAT:
+            return 8;
+        case VK_FORMAT_R32G32B32A32_SFLOAT:
+        case VK_FORMAT_R32G32B32A32_UINT:
+            return 16;
+        default:
+            return 4;
+    }
+}
+
+static bool is_same_texture_desc(const EzTextureDesc& a, const EzTextureDesc& b)
+{
+    return a.width == b.width && a.height == b.height && a.format == b.format && a.usage == b.usage;
+}
+
+RenderGraphPass::RenderGraphPass(RenderGraph* graph, const std::string& name)
+{
+    _graph = graph;
+    _name = name;
+}
+
+void RenderGraphPass::add_access(RenderGraphResource resource, EzResourceState state, bool write)
+{
+    // One access per resource and pass, so a single barrier covers every usage inside the pass
+    for (auto& access : _accesses)
+    {
+        if (access.resource == resource)
+        {
+            access.state |= state;
+            access.write = access.write || write;
+            return;
+        }
+    }
+    _accesses.push_back({resource, state, write});
+}
+
+RenderGraphPass& RenderGraphPass::read(RenderGraphResource resource, EzResourceState state)
+{
+    add_access(resource, state, false);
+    return *this;
+}
+
+RenderGraphPass& RenderGraphPass::read(EzBuffer buffer, EzResourceState state)
+{
+    return read(_graph->import_buffer(buffer), state);
+}
+
+RenderGraphPass& RenderGraphPass::read(EzTexture texture, EzResourceState state)
+{
+    return read(_graph->import_texture(texture), state);
+}
+
+RenderGraphPass& RenderGraphPass::write(RenderGraphResource resource, EzResourceState state)
+{
+    add_access(resource, state, true);
+    return *this;
+}
+
+RenderGraphPass& RenderGraphPass::write(EzBuffer buffer, EzResourceState state)
+{
+    return write(_graph->import_buffer(buffer), state);
+}
+
+RenderGraphPass& RenderGraphPass::write(EzTexture texture, EzResourceState state)
+{
+    return write(_graph->import_texture(texture), state);
+}
+
+RenderGraphPass& RenderGraphPass::set_side_effect()
+{
+    _side_effect = true;
+    return *this;
+}
+
+RenderGraphPass& RenderGraphPass::set_pipeline_statistics()
+{
+    _pipeline_statistics = true;
+    return *this;
+}
+
+RenderGraphPass& RenderGraphPass::set_execute(const std::function<void()>& execute)
+{
+    _execute = execute;
+    return *this;
+}
+
+RenderGraph::RenderGraph(uint32_t frames_in_flight, FrameFence* frame_fence)
+{
+    _frames_in_flight = frames_in_flight;
+    _frame_fence = frame_fence;
+}
+
+RenderGraph::~RenderGraph()
+{
+    reset();
+
+    for (auto& pooled_texture : _texture_pool)
+    {
+        ez_destroy_texture(pooled_texture.texture);
+    }
+    _texture_pool.clear();
+}
+
+void RenderGraph::release_buffer(EzBuffer buffer)
+{
+    _resource_states.erase(buffer);
+}
+
+void RenderGraph::reset()
+{
+    for (auto pass : _passes)
+    {
+        delete pass;
+    }
+    _passes.clear();
+    _resources.clear();
+    _barriers.clear();
+    _imported_resources.clear();
+    _pass_timings.clear();
+    _barrier_count = 0;
+    _culled_pass_count = 0;
+}
+
+RenderGraphResource RenderGraph::import_buffer(EzBuffer buffer)
+{
+    auto iter = _imported_resources.find(buffer);
+    if (iter != _imported_resources.end())
+        return iter->second;
+
+    Resource resource{};
+    resource.buffer = buffer;
+    _resources.push_back(resource);
+    RenderGraphResource handle = (RenderGraphResource)_resources.size() - 1;
+    _imported_resources[buffer] = handle;
+    return handle;
+}
+
+RenderGraphResource RenderGraph::import_texture(EzTexture texture)
+{
+    auto iter = _imported_resources.find(texture);
+    if (iter != _imported_resources.end())
+        return iter->second;
+
+    Resource resource{};
+    resource.texture = texture;
+    _resources.push_back(resource);
+    RenderGraphResource handle = (RenderGraphResource)_resources.size() - 1;
+    _imported_resources[texture] = handle;
+    return handle;
+}
+
+RenderGraphResource RenderGraph::import_swapchain(EzSwapchain swapchain)
+{
+    auto iter = _imported_resources.find(swapchain);
+    if (iter != _imported_resources.end())
+        return iter->second;
+
+    Resource resource{};
+    resource.swapchain = swapchain;
+    _resources.push_back(resource);
+    RenderGraphResource handle = (RenderGraphResource)_resources.size() - 1;
+    _imported_resources[swapchain] = handle;
+    return handle;
+}
+
+RenderGraphResource RenderGraph::create_texture(const std::string& name, const EzTextureDesc& desc, VkImageAspectFlags aspect)
+{
+    Resource resource{};
+    resource.name = name;
+    resource.transient = true;
+    resource.desc = desc;
+    resource.aspect = aspect;
+    _resources.push_back(resource);
+    return (RenderGraphResource)_resources.size() - 1;
+}
+
+RenderGraphPass& RenderGraph::add_pass(const std::string& name)
+{
+    RenderGraphPass* pass = new RenderGraphPass(this, name);
+    _passes.push_back(pass);
+    return *pass;
+}
+
+void RenderGraph::set_output(RenderGraphResource resource)
+{
+    _resources[resource].output = true;
+}
+
+EzBuffer RenderGraph::get_buffer(RenderGraphResource resource)
+{
+    return _resources[resource].buffer;
+}
+
+EzTexture RenderGraph::get_texture(RenderGraphResource resource)
+{
+    return _resources[resource].texture;
+}
+
+EzSwapchain RenderGraph::get_swapchain(RenderGraphResource resource)
+{
+    return _resources[resource].swapchain;
+}
+
+void RenderGraph::get_attachment(RenderGraphResource resource, EzRenderingAttachmentInfo& attachment_info)
+{
+    if (_resources[resource].swapchain)
+        attachment_info.swapchain = _resources[resource].swapchain;
+    else
+        attachment_info.texture = _resources[resource].texture;
+}
+
+uint64_t RenderGraph::get_transient_memory_size() const
+{
+    uint64_t size = 0;
+    for (auto& pooled_texture : _texture_pool)
+    {
+        size += (uint64_t)pooled_texture.desc.width * pooled_texture.desc.height * get_format_size(pooled_texture.desc.format);
+    }
+    return size;
+}
+
+void* RenderGraph::get_physical_handle(const Resource& resource)
+{
+    if (resource.buffer)
+        return resource.buffer;
+    if (resource.texture)
+        return resource.texture;
+    return resource.swapchain;
+}
+
+void RenderGraph::compile()
+{
+    PROFILE_SCOPE("render_graph_compile");
+
+    cull_passes();
+    allocate_transient_textures();
+    build_barriers();
+    _frame_number++;
+}
+
+void RenderGraph::cull_passes()
+{
+    // Walk backwards from the outputs, a pass survives if something later consumes one of its writes
+    std::vector<bool> needed(_resources.size(), false);
+    for (size_t i = 0; i < _resources.size(); ++i)
+    {
+        needed[i] = _resources[i].output;
+    }
+
+    for (int i = (int)_passes.size() - 1; i >= 0; --i)
+    {
+        RenderGraphPass* pass = _passes[i];
+        bool live = pass->_side_effect;
+        for (auto& access : pass->_accesses)
+        {
+            if (access.write && needed[access.resource])
+                live = true;
+        }
+
+        pass->_culled = !live;
+        if (!live)
+        {
+            _culled_pass_count++;
+            continue;
+        }
+
+        for (auto& access : pass->_accesses)
+        {
+            if (!access.write)
+                needed[access.resource] = true;
+        }
+    }
+}
+
+void RenderGraph::allocate_transient_textures()
+{
+    for (int i = 0; i < (int)_passes.size(); ++i)
+    {
+        if (_passes[i]->_culled)
+            continue;
+
+        for (auto& access : _passes[i]->_accesses)
+        {
+            Resource& resource = _resources[access.resource];
+            if (resource.first_pass < 0)
+                resource.first_pass = i;
+            resource.last_pass = i;
+        }
+    }
+
+    std::vector<RenderGraphResource> transients;
+    for (size_t i = 0; i < _resources.size(); ++i)
+    {
+        Resource& resource = _resources[i];
+        if (!resource.transient || resource.first_pass < 0)
+            continue;
+        if (resource.output)
+            resource.last_pass = (int)_passes.size();
+        transients.push_back((RenderGraphResource)i);
+    }
+    std::sort(transients.begin(), transients.end(), [this](RenderGraphResource a, RenderGraphResource b) {
+        return _resources[a].first_pass < _resources[b].first_pass;
+    });
+
+    for (auto& pooled_texture : _texture_pool)
+    {
+        pooled_texture.busy_until = -1;
+        pooled_texture.used = false;
+    }
+
+    // Greedy interval assignment, a pooled texture is shared by every transient whose lifetime starts after the previous one ended
+    for (auto handle : transients)
+    {
+        Resource& resource = _resources[handle];
+        PooledTexture* match = nullptr;
+        for (auto& pooled_texture : _texture_pool)
+        {
+            if (pooled_texture.busy_until < resource.first_pass && pooled_texture.aspect == resource.aspect && is_same_texture_desc(pooled_texture.desc, resource.desc))
+            {
+                match = &pooled_texture;
+                break;
+            }
+        }
+
+        if (!match)
+        {
+            PooledTexture pooled_texture{};
+            pooled_texture.desc = resource.desc;
+            pooled_texture.aspect = resource.aspect;
+            ez_create_texture(resource.desc, pooled_texture.texture);
+            ez_create_texture_view(pooled_texture.texture, VK_IMAGE_VIEW_TYPE_2D, resource.aspect, 0, 1, 0, 1);
+            _texture_pool.push_back(pooled_texture);
+            match = &_texture_pool.back();
+        }
+
+        match->busy_until = resource.last_pass;
+        match->used = true;
+        resource.texture = match->texture;
+    }
+
+    // Drop textures nobody asked for this frame, e.g. after a resize
+    for (auto iter = _texture_pool.begin(); iter != _texture_pool.end();)
+    {
+        if (!iter->used)
+        {
+            _resource_states.erase(iter->texture);
+            ez_destroy_texture(iter->texture);
+            iter = _texture_pool.erase(iter);
+        }
+        else
+        {
+            ++iter;
+        }
+    }
+}
+
+void RenderGraph::build_barriers()
+{
+    struct Tracker
+    {
+        EzResourceState state;
+        bool last_write;
+        bool known;
+        // Last accessed at least _frames_in_flight frames ago and not touched yet this frame
+        bool retired;
+        uint64_t last_frame;
+        // Barrier that opened the current run of reads, later reads merge their state into it
+        int read_pass;
+        int read_barrier;
+    };
+
+    // Every frame up to _frame_number - _frames_in_flight has completed once this returns, usually
+    // the owner already waited for it
+    if (_frame_fence)
+        _frame_fence->wait((uint32_t)(_frame_number % _frames_in_flight));
+
+    std::vector<Tracker> trackers(_resources.size());
+    for (size_t i = 0; i < _resources.size(); ++i)
+    {
+        Tracker& tracker = trackers[i];
+        tracker.state = EZ_RESOURCE_STATE_UNDEFINED;
+        tracker.last_write = false;
+        tracker.known = false;
+        tracker.retired = false;
+        tracker.last_frame = 0;
+        tracker.read_pass = -1;
+        tracker.read_barrier = -1;
+
+        // The acquired swapchain image changes every frame, its state is never carried over
+        if (_resources[i].swapchain)
+            continue;
+
+        auto iter = _resource_states.find(get_physical_handle(_resources[i]));
+        if (iter != _resource_states.end())
+        {
+            tracker.state = iter->second.state;
+            tracker.last_write = iter->second.last_write;
+            tracker.known = true;
+            tracker.last_frame = iter->second.last_frame;
+            tracker.retired = _frame_fence && _frame_number - iter->second.last_frame >= _frames_in_flight;
+        }
+    }
+
+    _barriers.clear();
+    _barriers.resize(_passes.size());
+    for (int i = 0; i < (int)_passes.size(); ++i)
+    {
+        if (_passes[i]->_culled)
+            continue;
+
+        for (auto& access : _passes[i]->_accesses)
+        {
+            Tracker& tracker = trackers[access.resource];
+            // Buffers have no layout, once the fence ordered the last access a write needs no barrier
+            bool retired = tracker.retired && _resources[access.resource].buffer;
+            tracker.retired = false;
+            tracker.last_frame = _frame_number;
+            if (access.write)
+            {
+                _barriers[i].push_back({access.resource, access.state, retired});
+                tracker.state = access.state;
+                tracker.last_write = true;
+                tracker.known = true;
+                tracker.read_pass = -1;
+                tracker.read_barrier = -1;
+            }
+            else if (tracker.read_pass >= 0)
+            {
+                Barrier& barrier = _barriers[tracker.read_pass][tracker.read_barrier];
+                barrier.state |= access.state;
+                tracker.state = barrier.state;
+            }
+            else if (!tracker.known || tracker.last_write || !contains_state(tracker.state, access.state))
+            {
+                _barriers[i].push_back({access.resource, access.state, false});
+                tracker.state = access.state;
+                tracker.last_write = false;
+                tracker.known = true;
+                tracker.read_pass = i;
+                tracker.read_barrier = (int)_barriers[i].size() - 1;
+            }
+        }
+    }
+
+    for (size_t i = 0; i < _resources.size(); ++i)
+    {
+        if (_resources[i].swapchain || !trackers[i].known)
+            continue;
+
+        ResourceState resource_state{};
+        resource_state.state = trackers[i].state;
+        resource_state.last_write = trackers[i].last_write;
+        resource_state.last_frame = trackers[i].last_frame;
+        _resource_states[get_physical_handle(_resources[i])] = resource_state;
+    }
+
+    // Textures are dropped with their pool entry, buffers once they stop being used
+    for (auto iter = _resource_states.begin(); iter != _resource_states.end();)
+    {
+        if (_frame_number - iter->second.last_frame > RESOURCE_STATE_MAX_AGE)
+            iter = _resource_states.erase(iter);
+        else
+            ++iter;
+    }
+}
+
+void RenderGraph::execute()
+{
+    PROFILE_SCOPE("render_graph_execute");
+
+    std::vector<VkBufferMemoryBarrier2> buffer_barriers;
+    std::vector<VkImageMemoryBarrier2> image_barriers;
+    for (size_t i = 0; i < _passes.size(); ++i)
+    {
+        RenderGraphPass* pass = _passes[i];
+        if (pass->_culled)
+            continue;
+
+        // Barriers are counted as part of the pass that needs them
+        if (_profiler)
+            _profiler->begin_pass(pass->_name);
+
+        buffer_barriers.clear();
+        image_barriers.clear();
+        for (auto& barrier : _barriers[i])
+        {
+            Resource& resource = _resources[barrier.resource];
+            if (resource.buffer)
+            {
+                // Built even when retired so ez keeps following the buffer state
+                VkBufferMemoryBarrier2 buffer_barrier = ez_buffer_barrier(resource.buffer, barrier.state);
+                if (!barrier.retired)
+                    buffer_barriers.push_back(buffer_barrier);
+            }
+            else if (resource.texture)
+                image_barriers.push_back(ez_image_barrier(resource.texture, barrier.state));
+            else if (resource.swapchain)
+                image_barriers.push_back(ez_image_barrier(resource.swapchain, barrier.state));
+        }
+
+        if (!buffer_barriers.empty() || !image_barriers.empty())
+        {
+            ez_pipeline_barrier(0, (uint32_t)buffer_barriers.size(), buffer_barriers.data(), (uint32_t)image_barriers.size(), image_barriers.data());
+            _barrier_count += (uint32_t)(buffer_barriers.size() + image_barriers.size());
+        }
+
+        if (_profiler && pass->_pipeline_statistics)
+            _profiler->begin_statistics(pass->_name);
+
+        auto start_time = std::chrono::high_resolution_clock::now();
+        if (pass->_execute)
+            pass->_execute();
+        auto end_time = std::chrono::high_resolution_clock::now();
+
+        if (_profiler && pass->_pipeline_statistics)
+            _profiler->end_statistics();
+        if (_profiler)
+            _profiler->end_pass();
+        _pass_timings.push_back({pass->_name, std::chrono::duration<double, std::milli>(end_time - start_time).count()});
+    }
+}
@@ -0,0 +1,186 @@
+#pragma once
+
+#include <rhi/ez_vulkan.h>
+#include <functional>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+typedef uint32_t RenderGraphResource;
+
+struct RenderGraphPassTiming
+{
+    std::string name;
+    // Recording time on the CPU, in milliseconds
+    double cpu_time;
+};
+
+class RenderGraph;
+class GpuProfiler;
+class FrameFence;
+
+class RenderGraphPass
+{
+public:
+    RenderGraphPass(RenderGraph* graph, const std::string& name);
+
+    RenderGraphPass& read(RenderGraphResource resource, EzResourceState state);
+
+    RenderGraphPass& read(EzBuffer buffer, EzResourceState state);
+
+    RenderGraphPass& read(EzTexture texture, EzResourceState state);
+
+    RenderGraphPass& write(RenderGraphResource resource, EzResourceState state);
+
+    RenderGraphPass& write(EzBuffer buffer, EzResourceState state);
+
+    RenderGraphPass& write(EzTexture texture, EzResourceState state);
+
+    // Never culled, e.g. passes that only produce CPU visible results
+    RenderGraphPass& set_side_effect();
+
+    // Records pipeline statistics for this pass when a profiler is attached
+    RenderGraphPass& set_pipeline_statistics();
+
+    RenderGraphPass& set_execute(const std::function<void()>& execute);
+
+    const std::string& get_name() const { return _name; }
+
+private:
+    friend class RenderGraph;
+
+    struct Access
+    {
+        RenderGraphResource resource;
+        EzResourceState state;
+        bool write;
+    };
+
+    void add_access(RenderGraphResource resource, EzResourceState state, bool write);
+
+    RenderGraph* _graph;
+    std::string _name;
+    std::vector<Access> _accesses;
+    std::function<void()> _execute;
+    bool _side_effect = false;
+    bool _pipeline_statistics = false;
+    bool _culled = false;
+};
+
+// Collects the passes of a frame with their declared reads and writes, culls passes whose
+// results are never consumed, emits one merged barrier batch per pass and aliases transient
+// textures whose lifetimes do not overlap.
+class RenderGraph
+{
+public:
+    // The owner signals frame_fence after executing every graph, with the graph's frame number. A buffer
+    // untouched for frames_in_flight frames is then known to be idle and its next write needs no barrier.
+    // Without a fence every access keeps its barrier.
+    RenderGraph(uint32_t frames_in_flight, FrameFence* frame_fence = nullptr);
+
+    ~RenderGraph();
+
+    void reset();
+
+    RenderGraphResource import_buffer(EzBuffer buffer);
+
+    // Forgets the tracked state of a buffer about to be destroyed, a new buffer at the same address
+    // must not inherit it
+    void release_buffer(EzBuffer buffer);
+
+    RenderGraphResource import_texture(EzTexture texture);
+
+    RenderGraphResource import_swapchain(EzSwapchain swapchain);
+
+    RenderGraphResource create_texture(const std::string& name, const EzTextureDesc& desc, VkImageAspectFlags aspect);
+
+    RenderGraphPass& add_pass(const std::string& name);
+
+    void set_output(RenderGraphResource resource);
+
+    // Writes timestamps around every executed pass
+    void set_profiler(GpuProfiler* profiler) { _profiler = profiler; }
+
+    void compile();
+
+    void execute();
+
+    EzBuffer get_buffer(RenderGraphResource resource);
+
+    EzTexture get_texture(RenderGraphResource resource);
+
+    EzSwapchain get_swapchain(RenderGraphResource resource);
+
+    void get_attachment(RenderGraphResource resource, EzRenderingAttachmentInfo& attachment_info);
+
+    uint32_t get_barrier_count() const { return _barrier_count; }
+
+    uint32_t get_culled_pass_count() const { return _culled_pass_count; }
+
+    const std::vector<RenderGraphPassTiming>& get_pass_timings() const { return _pass_timings; }
+
+    uint64_t get_transient_memory_size() const;
+
+private:
+    struct Resource
+    {
+        std::string name;
+        EzBuffer buffer = VK_NULL_HANDLE;
+        EzTexture texture = VK_NULL_HANDLE;
+        EzSwapchain swapchain = VK_NULL_HANDLE;
+        bool transient = false;
+        bool output = false;
+        EzTextureDesc desc{};
+        VkImageAspectFlags aspect = 0;
+        int first_pass = -1;
+        int last_pass = -1;
+    };
+
+    struct Barrier
+    {
+        RenderGraphResource resource;
+        EzResourceState state;
+        // Only updates the tracked state, the frame fence already ordered the previous access
+        bool retired;
+    };
+
+    // Last known state of a physical resource, kept across frames so read only resources
+    // already in a compatible state do not get a barrier every frame
+    struct ResourceState
+    {
+        EzResourceState state;
+        bool last_write;
+        uint64_t last_frame;
+    };
+
+    struct PooledTexture
+    {
+        EzTextureDesc desc;
+        VkImageAspectFlags aspect;
+        EzTexture texture;
+        int busy_until;
+        bool used;
+    };
+
+    void cull_passes();
+
+    void allocate_transient_textures();
+
+    void build_barriers();
+
+    void* get_physical_handle(const Resource& resource);
+
+    std::vector<Resource> _resources;
+    std::vector<RenderGraphPass*> _passes;
+    std::vector<std::vector<Barrier>> _barriers;
+    std::unordered_map<void*, RenderGraphResource> _imported_resources;
+    std::unordered_map<void*, ResourceState> _resource_states;
+    std::vector<PooledTexture> _texture_pool;
+    std::vector<RenderGraphPassTiming> _pass_timings;
+    GpuProfiler* _profiler = nullptr;
+    FrameFence* _frame_fence = nullptr;
+    uint32_t _frames_in_flight = 1;
+    uint64_t _frame_number = 0;
+    uint32_t _barrier_count = 0;
+    uint32_t _culled_pass_count = 0;
+};
@@ -0,0 +1,493 @@
+#include "renderer.h"
+#include "camera.h"
+#include "scene.h"
+#include "gpu_scene.h"
+#include "rsg.h"
+#include "shader_library.h"
+#include "cpu_profiler.h"
+#include "triangle_filtering_pass.h"
+#include "visibility_buffer_pass.h"
+#include "visibility_bufer_shading_pass.h"
+#include "hiz_pass.h"
+#include "shadow_pass.h"
+#include "light_culling_pass.h"
+#include "material_binning_pass.h"
+#include "readback.h"
+#include "frame_fence.h"
+#include <cstring>
+
+Renderer::Renderer()
+{
+    init_rsg();
+
+    EzBufferDesc buffer_desc{};
+    buffer_desc.size = sizeof(ViewBufferType);
+    buffer_desc.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
+    buffer_desc.memory_flags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    for (int i = 0; i < FRAMES_IN_FLIGHT; ++i)
+    {
+        ez_create_buffer(buffer_desc, _view_buffers[i]);
+    }
+
+    _frame_fence = new FrameFence(FRAMES_IN_FLIGHT);
+    _graph = new RenderGraph(FRAMES_IN_FLIGHT, _frame_fence);
+    _gpu_profiler = new GpuProfiler(FRAMES_IN_FLIGHT);
+    _graph->set_profiler(_gpu_profiler);
+    _triangle_filtering_pass = new TriangleFilteringPass(this);
+    _visibility_buffer_pass = new VisibilityBufferPass(this);
+    _visibility_buffer_shading_pass = new VisibilityBufferShadingPass(this);
+    _hiz_pass = new HiZPass(this);
+    _shadow_pass = new ShadowPass(this);
+    _light_culling_pass = new LightCullingPass(this);
+    _material_binning_pass = new MaterialBinningPass(this);
+}
+
+Renderer::~Renderer()
+{
+    uninit_rsg();
+
+    delete _triangle_filtering_pass;
+    delete _visibility_buffer_pass;
+    delete _visibility_buffer_shading_pass;
+    delete _hiz_pass;
+    delete _shadow_pass;
+    delete _light_culling_pass;
+    delete _material_binning_pass;
+    delete _graph;
+    delete _gpu_profiler;
+    delete _frame_fence;
+    if (_gpu_scene)
+        delete _gpu_scene;
+    uninit_shader_library();
+
+    for (int i = 0; i < FRAMES_IN_FLIGHT; ++i)
+    {
+        if (_view_buffers[i])
+            ez_destroy_buffer(_view_buffers[i]);
+    }
+    if (_history_vb)
+        ez_destroy_texture(_history_vb);
+    if (_history_depth)
+        ez_destroy_texture(_history_depth);
+}
+
+void Renderer::set_scene(Scene* scene)
+{
+    if (_scene != scene)
+    {
+        _scene = scene;
+        _scene_dirty = true;
+    }
+}
+
+void Renderer::set_camera(Camera* camera)
+{
+    if (_camera != camera)
+        _history_valid = false;
+    _camera = camera;
+}
+
+void Renderer::set_shade_to_swapchain(bool enable)
+{
+    _shade_to_swapchain = enable;
+}
+
+void Renderer::capture_visibility_buffer(EzTexture target)
+{
+    _vb_capture_target = target;
+}
+
+void Renderer::read_filtered_draws(std::vector<uint32_t>& indices, std::vector<DrawCommand>& draw_commands, std::vector<uint32_t>& draw_mesh_indices)
+{
+    std::vector<uint8_t> data;
+    readback_buffer(_triangle_filtering_pass->get_index_buffer(), data);
+    indices.resize(data.size() / sizeof(uint32_t));
+    memcpy(indices.data(), data.data(), indices.size() * sizeof(uint32_t));
+
+    readback_buffer(_triangle_filtering_pass->get_draw_command_buffer(), data);
+    draw_commands.resize(data.size() / sizeof(DrawCommand));
+    memcpy(draw_commands.data(), data.data(), draw_commands.size() * sizeof(DrawCommand));
+
+    readback_buffer(_triangle_filtering_pass->get_draw_mesh_buffer(), data);
+    draw_mesh_indices.resize(data.size() / sizeof(uint32_t));
+    memcpy(draw_mesh_indices.data(), data.data(), draw_mesh_indices.size() * sizeof(uint32_t));
+}
+
+void Renderer::set_cpu_triangle_filtering(bool enable)
+{
+    _triangle_filtering_pass->set_cpu_filtering(enable);
+    _history_valid = false;
+}
+
+void Renderer::set_temporal_reuse(bool enable)
+{
+    _temporal_reuse = enable;
+    _history_valid = false;
+}
+
+void Renderer::set_pipelined_filtering(bool enable)
+{
+    _triangle_filtering_pass->set_pipelined(enable);
+    _history_valid = false;
+}
+
+void Renderer::set_shadows(bool enable)
+{
+    _shadows = enable;
+    _history_valid = false;
+}
+
+void Renderer::set_sun_direction(const glm::vec3& direction)
+{
+    if (glm::normalize(direction) != _sun_direction)
+        _history_valid = false;
+    _sun_direction = glm::normalize(direction);
+}
+
+void Renderer::set_jitter(const glm::vec2& jitter)
+{
+    _jitter = jitter;
+}
+
+static void extract_frustum_planes(const glm::mat4& m, glm::vec4 planes[6])
+{
+    // Gribb-Hartmann, reversed-Z: the near plane is z <= w
+    glm::vec4 row0 = glm::vec4(m[0][0], m[1][0], m[2][0], m[3][0]);
+    glm::vec4 row1 = glm::vec4(m[0][1], m[1][1], m[2][1], m[3][1]);
+    glm::vec4 row2 = glm::vec4(m[0][2], m[1][2], m[2][2], m[3][2]);
+    glm::vec4 row3 = glm::vec4(m[0][3], m[1][3], m[2][3], m[3][3]);
+    planes[0] = row3 + row0;
+    planes[1] = row3 - row0;
+    planes[2] = row3 + row1;
+    planes[3] = row3 - row1;
+    planes[4] = row3 - row2;
+    for (int i = 0; i < 5; ++i)
+    {
+        planes[i] /= glm::length(glm::vec3(planes[i]));
+    }
+    // The far plane is at infinity, keep a plane that accepts everything
+    planes[5] = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+}
+
+static EzTextureDesc get_vb_desc(uint32_t width, uint32_t height)
+{
+    EzTextureDesc desc{};
+    desc.width = width;
+    desc.height = height;
+    desc.format = VK_FORMAT_B8G8R8A8_UNORM;
+    desc.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    return desc;
+}
+
+EzTextureDesc Renderer::get_depth_desc(uint32_t width, uint32_t height)
+{
+    EzTextureDesc desc{};
+    desc.width = width;
+    desc.height = height;
+    // Reversed-Z, float depth keeps the precision where 1 / z puts it
+    desc.format = VK_FORMAT_D32_SFLOAT;
+    desc.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    return desc;
+}
+
+void Renderer::update_history_targets()
+{
+    if (_history_vb && _history_vb->width == _width && _history_vb->height == _height)
+        return;
+
+    if (_history_vb)
+        ez_destroy_texture(_history_vb);
+    if (_history_depth)
+        ez_destroy_texture(_history_depth);
+
+    ez_create_texture(get_vb_desc(_width, _height), _history_vb);
+    ez_create_texture_view(_history_vb, VK_IMAGE_VIEW_TYPE_2D, VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1);
+    ez_create_texture(get_depth_desc(_width, _height), _history_depth);
+    ez_create_texture_view(_history_depth, VK_IMAGE_VIEW_TYPE_2D, VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, 0, 1);
+    _history_valid = false;
+}
+
+void Renderer::setup_rendertargets(bool need_color_rt)
+{
+    // Transient, the render graph aliases them with any other attachment whose lifetime does not overlap
+    if (need_color_rt)
+        _color_rt = _graph->create_texture("color_rt", get_vb_desc(_width, _height), VK_IMAGE_ASPECT_COLOR_BIT);
+
+    // Kept across frames when they may be reused
+    if (_temporal_reuse)
+    {
+        _vb_rt = _graph->import_texture(_history_vb);
+        _depth_rt = _graph->import_texture(_history_depth);
+    }
+    else
+    {
+        _vb_rt = _graph->create_texture("vb_rt", get_vb_desc(_width, _height), VK_IMAGE_ASPECT_COLOR_BIT);
+        _depth_rt = _graph->create_texture("depth_rt", get_depth_desc(_width, _height), VK_IMAGE_ASPECT_DEPTH_BIT);
+    }
+}
+
+void Renderer::update_view_buffer()
+{
+    glm::mat4 proj_matrix = _camera->get_proj_matrix();
+    glm::mat4 view_matrix = _camera->get_view_matrix();
+
+    // Sub-pixel offset applied in clip space
+    proj_matrix[2][0] += _jitter.x * 2.0f / (float)_width;
+    proj_matrix[2][1] += _jitter.y * 2.0f / (float)_height;
+
+    glm::mat4 view_proj_matrix = proj_matrix * view_matrix;
+    if (_frame_number == 0)
+    {
+        _prev_view_proj_matrix = view_proj_matrix;
+        _prev_jitter = _jitter;
+    }
+
+    ViewBufferType view_buffer_type{};
+    view_buffer_type.view_matrix = view_matrix;
+    view_buffer_type.proj_matrix = proj_matrix;
+    view_buffer_type.view_proj_matrix = view_proj_matrix;
+    view_buffer_type.inv_view_proj_matrix = glm::inverse(view_proj_matrix);
+    view_buffer_type.prev_view_proj_matrix = _prev_view_proj_matrix;
+    extract_frustum_planes(view_proj_matrix, view_buffer_type.frustum_planes);
+    view_buffer_type.viewport = glm::vec4((float)_width, (float)_height, 1.0f / (float)_width, 1.0f / (float)_height);
+    view_buffer_type.jitter = glm::vec4(_jitter, _prev_jitter);
+    view_buffer_type.camera_position = glm::vec4(_camera->get_translation(), 1.0f);
+    view_buffer_type.sun_direction = glm::vec4(_sun_direction, _shadows ? 1.0f : 0.0f);
+    view_buffer_type.tile_count = glm::uvec4((_width + SCREEN_TILE_SIZE - 1) / SCREEN_TILE_SIZE, (_height + SCREEN_TILE_SIZE - 1) / SCREEN_TILE_SIZE,
+                                             (uint32_t)_scene->lights.size(), _gpu_scene->material_count);
+
+    if (_shadows)
+    {
+        // Without the jitter, the cascades would move every frame
+        glm::mat4 inv_view_proj_matrix = glm::inverse(_camera->get_proj_matrix() * view_matrix);
+        compute_shadow_cascades(inv_view_proj_matrix, _camera->get_near(), _camera->get_far(), _sun_direction, _scene->bounds, SHADOW_MAP_SIZE, _shadow_cascades);
+        for (uint32_t i = 0; i < SHADOW_CASCADE_COUNT; ++i)
+        {
+            view_buffer_type.shadow_matrices[i] = _shadow_cascades[i].view_proj_matrix;
+            view_buffer_type.shadow_split_distances[i] = _shadow_cascades[i].split_distance;
+            view_buffer_type.shadow_texel_sizes[i] = _shadow_cascades[i].texel_size;
+        }
+    }
+
+    _view_proj_matrix = view_proj_matrix;
+    _prev_view_proj_matrix = view_proj_matrix;
+    _prev_jitter = _jitter;
+
+    // Host visible and coherent, the write is made available at submit without any copy or barrier.
+    // The frame fence already waited for the last frame that read this slot.
+    void* mapped_data = nullptr;
+    EzBuffer view_buffer = get_view_buffer();
+    ez_map_memory(view_buffer, &mapped_data);
+    memcpy(mapped_data, &view_buffer_type, sizeof(ViewBufferType));
+    ez_unmap_memory(view_buffer);
+}
+
+bool Renderer::begin_frame(uint32_t width, uint32_t height)
+{
+    if (!_scene || !_camera)
+        return false;
+
+    if (width == 0 || height == 0)
+        return false;
+
+    // FRAMES_IN_FLIGHT frames back, the last frame that used this frame index's ring slots
+    _frame_fence->wait(get_frame_index());
+
+    _width = width;
+    _height = height;
+    if (_scene_dirty || _scene->version != _scene_version)
+    {
+        if (_gpu_scene)
+        {
+            EzBuffer buffers[] = {_gpu_scene->position_buffer, _gpu_scene->normal_buffer, _gpu_scene->uv_buffer, _gpu_scene->index_buffer,
+                                  _gpu_scene->filtered_index_buffer, _gpu_scene->mesh_constants_buffer, _gpu_scene->draw_command_buffer,
+                                  _gpu_scene->light_buffer, _gpu_scene->material_buffer};
+            for (auto buffer : buffers)
+            {
+                _graph->release_buffer(buffer);
+            }
+            delete _gpu_scene;
+        }
+        _gpu_scene = new GpuScene(_scene);
+        _scene_dirty = false;
+        _scene_version = _scene->version;
+        _history_valid = false;
+    }
+
+    if (_temporal_reuse)
+        update_history_targets();
+
+    // Nothing that feeds culling or rasterization changed, last frame's visibility buffer still holds
+    if (_camera->get_version() != _camera_version || _jitter != _prev_jitter)
+        _history_valid = false;
+    _camera_version = _camera->get_version();
+    _reuse_visibility_buffer = _temporal_reuse && _history_valid;
+    _history_valid = _temporal_reuse;
+
+    update_view_buffer();
+
+    _gpu_profiler->begin_frame(get_frame_index());
+    _graph->reset();
+    return true;
+}
+
+void Renderer::setup_passes()
+{
+    PROFILE_SCOPE("setup_passes");
+
+    if (!_reuse_visibility_buffer)
+    {
+        _triangle_filtering_pass->setup(_graph);
+
+        _visibility_buffer_pass->setup(_graph);
+    }
+
+    _hiz_pass->setup(_graph);
+
+    if (_shadows)
+        _shadow_pass->setup(_graph);
+
+    _light_culling_pass->setup(_graph);
+
+    _material_binning_pass->setup(_graph);
+
+    _visibility_buffer_shading_pass->setup(_graph);
+
+    if (_vb_capture_target)
+    {
+        EzTexture target = _vb_capture_target;
+        _graph->add_pass("capture_visibility_buffer")
+            .read(_vb_rt, EZ_RESOURCE_STATE_COPY_SOURCE)
+            .write(target, EZ_RESOURCE_STATE_COPY_DEST)
+            .set_side_effect()
+            .set_execute([this, target]() {
+                VkImageCopy copy_region = {};
+                copy_region.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+                copy_region.srcSubresource.layerCount = 1;
+                copy_region.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+                copy_region.dstSubresource.layerCount = 1;
+                copy_region.extent = { _width, _height, 1 };
+                ez_copy_image(_graph->get_texture(_vb_rt), target, copy_region);
+            });
+        _vb_capture_target = VK_NULL_HANDLE;
+    }
+}
+
+void Renderer::end_frame()
+{
+    _graph->compile();
+    _graph->execute();
+    _frame_fence->signal(get_frame_index());
+
+    const TriangleFilteringStats& filtering_stats = _triangle_filtering_pass->get_stats();
+    _frame_stats.cluster_count = filtering_stats.cluster_count;
+    _frame_stats.visible_cluster_count = filtering_stats.visible_cluster_count;
+    _frame_stats.tested_cluster_count = filtering_stats.tested_cluster_count;
+    _frame_stats.triangle_count = filtering_stats.triangle_count;
+    _frame_stats.visible_triangle_count = filtering_stats.visible_triangle_count;
+    _frame_stats.barrier_count = _graph->get_barrier_count();
+    _frame_stats.culled_pass_count = _graph->get_culled_pass_count();
+    _frame_stats.pass_timings = _graph->get_pass_timings();
+    _frame_stats.gpu_pass_timings = _gpu_profiler->get_resolved_timings();
+    _frame_stats.gpu_timings_frame_number = _frame_number >= FRAMES_IN_FLIGHT ? _frame_number - FRAMES_IN_FLIGHT : 0;
+    _frame_stats.gpu_frame_time = _gpu_profiler->get_resolved_frame_time();
+    _frame_stats.pipeline_statistics = _gpu_profiler->get_resolved_statistics();
+
+    const DrawCounter& gpu_counters = _triangle_filtering_pass->get_gpu_counters();
+    _frame_stats.gpu_counters_frame_number = _triangle_filtering_pass->get_gpu_counters_frame_number();
+    _frame_stats.gpu_batch_count = gpu_counters.batch_count;
+    _frame_stats.gpu_input_triangle_count = gpu_counters.input_triangle_count;
+    _frame_stats.gpu_output_triangle_count = gpu_counters.output_triangle_count;
+    _frame_stats.gpu_draw_count = gpu_counters.count;
+    _frame_stats.dropped_view_count = _triangle_filtering_pass->get_dropped_view_count();
+    _frame_stats.dropped_cluster_count = _triangle_filtering_pass->get_dropped_cluster_count();
+    _frame_stats.reused_visibility_buffer = _reuse_visibility_buffer;
+
+    _frame_number++;
+}
+
+void Renderer::render(EzSwapchain swapchain)
+{
+    if (!begin_frame(swapchain->width, swapchain->height))
+        return;
+
+    // The copy needs a matching format anyway, shading directly also avoids a full screen read and write
+    bool shade_to_swapchain = _shade_to_swapchain && swapchain->format == VK_FORMAT_B8G8R8A8_UNORM;
+    setup_rendertargets(!shade_to_swapchain);
+
+    RenderGraphResource swapchain_resource = _graph->import_swapchain(swapchain);
+    _output_rt = shade_to_swapchain ? swapchain_resource : _color_rt;
+
+    setup_passes();
+
+    // Copy to swapchain
+    if (!shade_to_swapchain)
+    {
+        _graph->add_pass("copy_to_swapchain")
+            .read(_color_rt, EZ_RESOURCE_STATE_COPY_SOURCE)
+            .write(swapchain_resource, EZ_RESOURCE_STATE_COPY_DEST)
+            .set_execute([this, swapchain]() {
+                VkImageCopy copy_region = {};
+                copy_region.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+                copy_region.srcSubresource.layerCount = 1;
+                copy_region.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+                copy_region.dstSubresource.layerCount = 1;
+                copy_region.extent = { swapchain->width, swapchain->height, 1 };
+                ez_copy_image(_graph->get_texture(_color_rt), swapchain, copy_region);
+            });
+    }
+    _graph->set_output(swapchain_resource);
+
+    end_frame();
+}
+
+void Renderer::render(EzTexture target)
+{
+    if (!begin_frame(target->width, target->height))
+        return;
+
+    setup_rendertargets(false);
+
+    _output_rt = _graph->import_texture(target);
+
+    setup_passes();
+
+    _graph->set_output(_output_rt);
+
+    end_frame();
+}
+
+uint64_t Renderer::get_transient_memory_size() const
+{
+    return _graph->get_transient_memory_size();
+}
+
+uint64_t Renderer::get_gpu_memory_size() const
+{
+    uint64_t size = sizeof(ViewBufferType) * FRAMES_IN_FLIGHT;
+    size += _triangle_filtering_pass->get_gpu_memory_size();
+    size += _graph->get_transient_memory_size();
+    size += _hiz_pass->get_gpu_memory_size();
+    size += _shadow_pass->get_gpu_memory_size();
+    size += _light_culling_pass->get_gpu_memory_size();
+    size += _material_binning_pass->get_gpu_memory_size();
+    // B8G8R8A8 visibility buffer and D32 depth
+    if (_history_vb)
+        size += (uint64_t)_history_vb->width * _history_vb->height * 8;
+    if (_gpu_scene)
+        size += _gpu_scene->get_gpu_memory_size();
+    return size;
+}
+
+EzTexture Renderer::create_offscreen_target(uint32_t width, uint32_t height)
+{
+    EzTextureDesc desc{};
+    desc.width = width;
+    desc.height = height;
+    desc.format = VK_FORMAT_B8G8R8A8_UNORM;
+    desc.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    EzTexture target = VK_NULL_HANDLE;
+    ez_create_texture(desc, target);
+    ez_create_texture_view(target, VK_IMAGE_VIEW_TYPE_2D, VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1);
+    return target;
+}
@@ -0,0 +1,209 @@
+#pragma once
+#include "render_graph.h"
+#include "gpu_profiler.h"
+#include "shadow_cascades.h"
+#include <rhi/ez_vulkan.h>
+#include <glm/glm.hpp>
+#include <vector>
+
+#define FRAMES_IN_FLIGHT 3
+// Pixels per side of the screen tiles the lights and materials are binned into, keep in sync with shader_defs.glsl
+#define SCREEN_TILE_SIZE 16
+
+class Scene;
+class GpuScene;
+class Camera;
+class FrameFence;
+struct DrawCommand;
+
+// Keep in sync with ViewConstants in shader_defs.glsl (std140)
+struct ViewBufferType
+{
+    glm::mat4 view_matrix;
+    glm::mat4 proj_matrix;
+    glm::mat4 view_proj_matrix;
+    glm::mat4 inv_view_proj_matrix;
+    glm::mat4 prev_view_proj_matrix;
+    glm::vec4 frustum_planes[6];
+    // xy: size, zw: 1 / size
+    glm::vec4 viewport;
+    // xy: current jitter, zw: previous jitter (in pixels)
+    glm::vec4 jitter;
+    glm::vec4 camera_position;
+    // xyz: direction the light travels, w: 1 with shadows
+    glm::vec4 sun_direction;
+    glm::mat4 shadow_matrices[SHADOW_CASCADE_COUNT];
+    glm::vec4 shadow_split_distances;
+    glm::vec4 shadow_texel_sizes;
+    // xy: screen tiles, z: light count, w: material count
+    glm::uvec4 tile_count;
+};
+
+struct FrameStats
+{
+    uint32_t cluster_count = 0;
+    uint32_t visible_cluster_count = 0;
+    // Clusters whose cone test ran, the others reused the cached result
+    uint32_t tested_cluster_count = 0;
+    uint32_t triangle_count = 0;
+    uint32_t visible_triangle_count = 0;
+    uint32_t barrier_count = 0;
+    uint32_t culled_pass_count = 0;
+    std::vector<RenderGraphPassTiming> pass_timings;
+    // GPU durations read back this frame, they belong to frame gpu_timings_frame_number
+    std::vector<GpuPassTiming> gpu_pass_timings;
+    uint64_t gpu_timings_frame_number = 0;
+    // Milliseconds the GPU spent on that frame, first to last timestamp, 0 if not available
+    double gpu_frame_time = 0.0;
+    // Raster and shading pipeline statistics, same latency as the timings
+    std::vector<GpuPipelineStatistics> pipeline_statistics;
+    // Counters written by the filtering and compaction shaders of frame gpu_counters_frame_number
+    uint64_t gpu_counters_frame_number = 0;
+    uint32_t gpu_batch_count = 0;
+    uint32_t gpu_input_triangle_count = 0;
+    uint32_t gpu_output_triangle_count = 0;
+    uint32_t gpu_draw_count = 0;
+    // Shadow cascades left empty because the draws of all cascades did not fit in MAX_DRAW_CMD_COUNT
+    uint32_t dropped_view_count = 0;
+    // Visible clusters of the camera left out because their draws did not fit in MAX_DRAW_CMD_COUNT - 1
+    uint32_t dropped_cluster_count = 0;
+    // Camera, jitter and scene were unchanged, filtering and the visibility buffer pass were skipped
+    bool reused_visibility_buffer = false;
+};
+
+class Renderer
+{
+public:
+    Renderer();
+
+    ~Renderer();
+
+    void render(EzSwapchain swapchain);
+
+    // Headless rendering, no window or present involved
+    void render(EzTexture target);
+
+    static EzTexture create_offscreen_target(uint32_t width, uint32_t height);
+
+    void set_scene(Scene* scene);
+
+    void set_camera(Camera* camera);
+
+    void set_jitter(const glm::vec2& jitter);
+
+    const FrameStats& get_frame_stats() const { return _frame_stats; }
+
+    // Frames rendered so far, the number the next frame gets
+    uint64_t get_frame_number() const { return _frame_number; }
+
+    // Smoothed GPU duration of every render graph pass
+    const std::vector<GpuPassTiming>& get_gpu_pass_timings() const { return _gpu_profiler->get_smoothed_timings(); }
+
+    uint64_t get_gpu_memory_size() const;
+
+    // Shade straight into the acquired swapchain image when its format matches the color target
+    void set_shade_to_swapchain(bool enable);
+
+    // Copies the visibility buffer of the next frame into target (B8G8R8A8_UNORM, transfer destination)
+    void capture_visibility_buffer(EzTexture target);
+
+    // Blocking readback of the filtered indices, compacted draws and mesh of every draw of the last
+    // frame, what the draw and primitive ids of its visibility buffer refer to
+    void read_filtered_draws(std::vector<uint32_t>& indices, std::vector<DrawCommand>& draw_commands, std::vector<uint32_t>& draw_mesh_indices);
+
+    // Triangle filtering and batch compaction on the CPU, the results are uploaded every frame
+    void set_cpu_triangle_filtering(bool enable);
+
+    // Keeps the visibility buffer and the filtering results of the last frame and only shades again
+    // while the camera, jitter and scene stay the same. Costs a persistent visibility and depth buffer.
+    void set_temporal_reuse(bool enable);
+
+    // Triangle filtering writes one set of outputs per frame in flight, so its compute work does
+    // not wait for the previous frame to finish drawing and shading. Costs FRAMES_IN_FLIGHT - 1
+    // extra filtered index buffers.
+    void set_pipelined_filtering(bool enable);
+
+    // Cascaded shadows of the sun up to the camera far distance, see ShadowPass
+    void set_shadows(bool enable);
+
+    void set_sun_direction(const glm::vec3& direction);
+
+    // Render graph textures, transients sharing a texture count once
+    uint64_t get_transient_memory_size() const;
+
+private:
+    // Every depth target, the graph only shares textures with equal descs
+    static EzTextureDesc get_depth_desc(uint32_t width, uint32_t height);
+
+    bool begin_frame(uint32_t width, uint32_t height);
+
+    void setup_passes();
+
+    void end_frame();
+
+    void setup_rendertargets(bool need_color_rt);
+
+    void update_history_targets();
+
+    void update_view_buffer();
+
+    uint32_t get_frame_index() const { return (uint32_t)(_frame_number % FRAMES_IN_FLIGHT); }
+
+    EzBuffer get_view_buffer() const { return _view_buffers[get_frame_index()]; }
+
+    uint32_t _width = 0;
+    uint32_t _height = 0;
+    uint64_t _frame_number = 0;
+    Scene* _scene = nullptr;
+    GpuScene* _gpu_scene = nullptr;
+    bool _scene_dirty = true;
+    uint64_t _scene_version = 0;
+    Camera* _camera = nullptr;
+    uint64_t _camera_version = 0;
+    bool _temporal_reuse = true;
+    // The persistent targets hold the result of the current camera, scene and jitter
+    bool _history_valid = false;
+    bool _reuse_visibility_buffer = false;
+    EzTexture _history_vb = VK_NULL_HANDLE;
+    EzTexture _history_depth = VK_NULL_HANDLE;
+    glm::vec2 _jitter = glm::vec2(0.0f);
+    glm::vec2 _prev_jitter = glm::vec2(0.0f);
+    glm::mat4 _view_proj_matrix = glm::mat4(1.0f);
+    glm::mat4 _prev_view_proj_matrix = glm::mat4(1.0f);
+    EzBuffer _view_buffers[FRAMES_IN_FLIGHT] = {};
+    // Waited on at the start of every frame, the per frame data of get_frame_index() is free to
+    // rewrite from then on
+    FrameFence* _frame_fence = nullptr;
+    RenderGraph* _graph = nullptr;
+    GpuProfiler* _gpu_profiler = nullptr;
+    RenderGraphResource _color_rt;
+    RenderGraphResource _depth_rt;
+    RenderGraphResource _vb_rt;
+    // Min/max depth pyramid, see HiZPass
+    RenderGraphResource _hiz_rt;
+    RenderGraphResource _shadow_rt;
+    bool _shadows = false;
+    glm::vec3 _sun_direction = glm::normalize(glm::vec3(0.0f, -1.0f, -1.0f));
+    ShadowCascade _shadow_cascades[SHADOW_CASCADE_COUNT] = {};
+    // Material of every pixel as depth, see MaterialBinningPass
+    RenderGraphResource _material_depth_rt;
+    // Either _color_rt or the swapchain image
+    RenderGraphResource _output_rt;
+    bool _shade_to_swapchain = true;
+    EzTexture _vb_capture_target = VK_NULL_HANDLE;
+    FrameStats _frame_stats;
+    friend class TriangleFilteringPass;
+    TriangleFilteringPass* _triangle_filtering_pass = nullptr;
+    friend class VisibilityBufferPass;
+    VisibilityBufferPass* _visibility_buffer_pass = nullptr;
+    friend class VisibilityBufferShadingPass;
+    VisibilityBufferShadingPass* _visibility_buffer_shading_pass = nullptr;
+    friend class HiZPass;
+    HiZPass* _hiz_pass = nullptr;
+    friend class ShadowPass;
+    ShadowPass* _shadow_pass = nullptr;
+    friend class LightCullingPass;
+    LightCullingPass* _light_culling_pass = nullptr;
+    friend class MaterialBinningPass;
+    MaterialBinningPass* _material_binning_pass = nullptr;
+};
\ No newline at end of file
@@ -1,6 +1,7 @@
 #include "rsg.h"
 
 EzBuffer RSG::quad_buffer = VK_NULL_HANDLE;
+EzBuffer RSG::quad_index_buffer = VK_NULL_HANDLE;
 EzBuffer RSG::cube_buffer = VK_NULL_HANDLE;
 
 void create_quad_buffer()
@@ -29,6 +30,23 @@ void create_quad_buffer()
     ez_pipeline_barrier(0, 1, &barrier, 0, nullptr);
 }
 
+void create_quad_index_buffer()
+{
+    static uint32_t quad_indices[] = {0, 1, 2, 3, 4, 5};
+
+    EzBufferDesc buffer_desc = {};
+    buffer_desc.size = sizeof(quad_indices);
+    buffer_desc.usage = VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
+    buffer_desc.memory_flags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+    ez_create_buffer(buffer_desc, RSG::quad_index_buffer);
+
+    VkBufferMemoryBarrier2 barrier = ez_buffer_barrier(RSG::quad_index_buffer, EZ_RESOURCE_STATE_COPY_DEST);
+    ez_pipeline_barrier(0, 1, &barrier, 0, nullptr);
+    ez_update_buffer(RSG::quad_index_buffer, sizeof(quad_indices), 0, quad_indices);
+    barrier = ez_buffer_barrier(RSG::quad_index_buffer, EZ_RESOURCE_STATE_INDEX_BUFFER);
+    ez_pipeline_barrier(0, 1, &barrier, 0, nullptr);
+}
+
 void create_cube_buffer()
 {
     static float cube_vertices[] = {
@@ -92,11 +110,13 @@ void create_cube_buffer()
 void init_rsg()
 {
     create_quad_buffer();
+    create_quad_index_buffer();
     create_cube_buffer();
 }
 
 void uninit_rsg()
 {
     ez_destroy_buffer(RSG::quad_buffer);
+    ez_destroy_buffer(RSG::quad_index_buffer);
     ez_destroy_buffer(RSG::cube_buffer);
 }
\ No newline at end of file
@@ -6,6 +6,8 @@ class RenderingServerGlobals
 {
 public:
     static EzBuffer quad_buffer;
+    // 0 to 5, draws quad_buffer through the indexed indirect draws
+    static EzBuffer quad_index_buffer;
     static EzBuffer cube_buffer;
 };
 
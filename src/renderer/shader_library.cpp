@@ -0,0 +1,51 @@
+#include "shader_library.h"
+#include <rhi/rhi_shader_mgr.h>
+#include <fstream>
+#include <unordered_map>
+#include <vector>
+
+static std::unordered_map<std::string, EzShader> g_shaders;
+static std::vector<EzShader> g_owned_shaders;
+
+static EzShader load_spirv_shader(const std::string& name)
+{
+#ifdef SHADER_BINARY_DIR
+    std::ifstream file(std::string(SHADER_BINARY_DIR) + "/" + name + ".spv", std::ios::binary | std::ios::ate);
+    if (!file.is_open())
+        return VK_NULL_HANDLE;
+
+    std::vector<char> code((size_t)file.tellg());
+    file.seekg(0);
+    file.read(code.data(), code.size());
+
+    EzShader shader = VK_NULL_HANDLE;
+    ez_create_shader(code.data(), code.size(), shader);
+    g_owned_shaders.push_back(shader);
+    return shader;
+#else
+    return VK_NULL_HANDLE;
+#endif
+}
+
+void uninit_shader_library()
+{
+    for (auto shader : g_owned_shaders)
+    {
+        ez_destroy_shader(shader);
+    }
+    g_owned_shaders.clear();
+    g_shaders.clear();
+}
+
+EzShader get_shader(const std::string& name)
+{
+    auto iter = g_shaders.find(name);
+    if (iter != g_shaders.end())
+        return iter->second;
+
+    EzShader shader = load_spirv_shader(name);
+    if (!shader)
+        shader = rhi_get_shader(("shader://" + name).c_str());
+    g_shaders[name] = shader;
+    return shader;
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <rhi/ez_vulkan.h>
+#include <string>
+
+void uninit_shader_library();
+
+// Prefers the SPIR-V compiled at build time and falls back to runtime GLSL compilation,
+// resolve once and keep the handle instead of looking shaders up every frame.
+// Only the shader modules are ready after that, ez still creates every pipeline on the first
+// draw or dispatch using it and offers no pipeline cache, so the first frame keeps that cost.
+EzShader get_shader(const std::string& name);
@@ -0,0 +1,192 @@
+#include "shadow_pass.h"
+#include "triangle_filtering_pass.h"
+#include "hiz_pass.h"
+#include "gpu_scene.h"
+#include "render_graph.h"
+#include "shader_library.h"
+#include <algorithm>
+#include <cstring>
+
+// Largest uniform buffer offset alignment allowed by Vulkan
+#define CASCADE_BUFFER_STRIDE 256
+// The receiver mask reads the Hi-Z mip covering 8x8 pixels per texel
+#define RECEIVER_MASK_HIZ_MIP 2
+
+ShadowPass::ShadowPass(Renderer* renderer)
+{
+    _renderer = renderer;
+
+    EzSamplerDesc sampler_desc{};
+    sampler_desc.address_u = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    sampler_desc.address_v = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    sampler_desc.address_w = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    ez_create_sampler(sampler_desc, _sampler);
+
+    _receiver_mask_shader = get_shader("shadow_receiver_mask.comp");
+    _vertex_shader = get_shader("shadow_depth.vert");
+
+    EzTextureDesc desc{};
+    desc.width = SHADOW_MAP_SIZE * SHADOW_CASCADE_COUNT;
+    desc.height = SHADOW_MAP_SIZE;
+    desc.format = VK_FORMAT_D32_SFLOAT;
+    desc.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    ez_create_texture(desc, _shadow_texture);
+    ez_create_texture_view(_shadow_texture, VK_IMAGE_VIEW_TYPE_2D, VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, 0, 1);
+
+    EzBufferDesc buffer_desc{};
+    buffer_desc.size = sizeof(uint32_t) * RECEIVER_MASK_SIZE * SHADOW_CASCADE_COUNT;
+    buffer_desc.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+    buffer_desc.memory_flags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    for (int i = 0; i < FRAMES_IN_FLIGHT; ++i)
+    {
+        ez_create_buffer(buffer_desc, _receiver_mask_buffers[i]);
+    }
+
+    buffer_desc.size = CASCADE_BUFFER_STRIDE * SHADOW_CASCADE_COUNT;
+    buffer_desc.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
+    for (int i = 0; i < FRAMES_IN_FLIGHT; ++i)
+    {
+        ez_create_buffer(buffer_desc, _cascade_buffers[i]);
+    }
+}
+
+ShadowPass::~ShadowPass()
+{
+    ez_destroy_sampler(_sampler);
+    ez_destroy_texture(_shadow_texture);
+    for (int i = 0; i < FRAMES_IN_FLIGHT; ++i)
+    {
+        ez_destroy_buffer(_receiver_mask_buffers[i]);
+        ez_destroy_buffer(_cascade_buffers[i]);
+    }
+}
+
+void ShadowPass::setup(RenderGraph* graph)
+{
+    _renderer->_shadow_rt = graph->import_texture(_shadow_texture);
+
+    // The sun and the view are unchanged, the atlas of the frame the visibility buffer came from still holds
+    if (_renderer->_reuse_visibility_buffer)
+        return;
+
+    TriangleFilteringPass* triangle_filtering_pass = _renderer->_triangle_filtering_pass;
+    std::vector<CullingView> views;
+    for (uint32_t i = 0; i < SHADOW_CASCADE_COUNT; ++i)
+    {
+        views.push_back(_renderer->_shadow_cascades[i].culling_view);
+    }
+    triangle_filtering_pass->set_views(views);
+
+    EzBuffer receiver_mask_buffer = _receiver_mask_buffers[_renderer->get_frame_index()];
+    graph->add_pass("shadow_receiver_mask")
+        .read(_renderer->_hiz_rt, EZ_RESOURCE_STATE_SHADER_RESOURCE)
+        .write(receiver_mask_buffer, EZ_RESOURCE_STATE_UNORDERED_ACCESS)
+        .set_execute([this]() { build_receiver_mask(); });
+
+    triangle_filtering_pass->setup_views(graph, receiver_mask_buffer);
+
+    graph->add_pass("shadow_depth")
+        .read(_renderer->_gpu_scene->position_buffer, EZ_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER)
+        .read(triangle_filtering_pass->get_view_index_buffer(), EZ_RESOURCE_STATE_INDEX_BUFFER)
+        .read(triangle_filtering_pass->get_view_draw_command_buffer(), EZ_RESOURCE_STATE_INDIRECT_ARGUMENT)
+        .write(_renderer->_shadow_rt, EZ_RESOURCE_STATE_DEPTH_WRITE)
+        .set_pipeline_statistics()
+        .set_execute([this]() { render(); });
+}
+
+void ShadowPass::build_receiver_mask()
+{
+    // Host visible, the frame fence waited for the previous use of this frame's buffer
+    void* mapped_data = nullptr;
+    EzBuffer receiver_mask_buffer = _receiver_mask_buffers[_renderer->get_frame_index()];
+    ez_map_memory(receiver_mask_buffer, &mapped_data);
+    memset(mapped_data, 0, receiver_mask_buffer->size);
+    ez_unmap_memory(receiver_mask_buffer);
+
+    EzTexture hiz_rt = _renderer->_graph->get_texture(_renderer->_hiz_rt);
+    uint32_t mip = std::min((uint32_t)RECEIVER_MASK_HIZ_MIP, _renderer->_hiz_pass->get_mip_count() - 1);
+    EzBuffer view_buffer = _renderer->get_view_buffer();
+
+    ez_reset_pipeline_state();
+
+    ez_bind_texture(0, hiz_rt, 1 + mip);
+    ez_bind_sampler(1, _sampler);
+    ez_bind_buffer(2, view_buffer, view_buffer->size);
+    ez_bind_buffer(3, receiver_mask_buffer, receiver_mask_buffer->size);
+    ez_set_compute_shader(_receiver_mask_shader);
+
+    uint32_t width = std::max(1u, hiz_rt->width >> mip);
+    uint32_t height = std::max(1u, hiz_rt->height >> mip);
+    ez_dispatch((width + 7) / 8, (height + 7) / 8, 1);
+}
+
+void ShadowPass::render()
+{
+    TriangleFilteringPass* triangle_filtering_pass = _renderer->_triangle_filtering_pass;
+    EzBuffer index_buffer = triangle_filtering_pass->get_view_index_buffer();
+    EzBuffer draw_command_buffer = triangle_filtering_pass->get_view_draw_command_buffer();
+    // Filled while culling, before this pass executes
+    const std::vector<ViewCullingRange>& view_ranges = triangle_filtering_pass->get_view_ranges();
+
+    void* mapped_data = nullptr;
+    EzBuffer cascade_buffer = _cascade_buffers[_renderer->get_frame_index()];
+    ez_map_memory(cascade_buffer, &mapped_data);
+    for (uint32_t i = 0; i < SHADOW_CASCADE_COUNT; ++i)
+    {
+        memcpy((uint8_t*)mapped_data + i * CASCADE_BUFFER_STRIDE, &_renderer->_shadow_cascades[i].view_proj_matrix, sizeof(glm::mat4));
+    }
+    ez_unmap_memory(cascade_buffer);
+
+    ez_reset_pipeline_state();
+
+    EzRenderingAttachmentInfo depth_info{};
+    depth_info.texture = _renderer->_graph->get_texture(_renderer->_shadow_rt);
+    depth_info.clear_value.depthStencil = {0.0f, 0};
+
+    EzRenderingInfo rendering_info{};
+    rendering_info.width = SHADOW_MAP_SIZE * SHADOW_CASCADE_COUNT;
+    rendering_info.height = SHADOW_MAP_SIZE;
+    rendering_info.depth.push_back(depth_info);
+    ez_begin_rendering(rendering_info);
+
+    // Depth only
+    ez_set_vertex_shader(_vertex_shader);
+
+    ez_set_vertex_binding(0, 12);
+    ez_set_vertex_attrib(0, 0, VK_FORMAT_R32G32B32_SFLOAT, 0);
+
+    ez_set_primitive_topology(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST);
+
+    EzDepthState depth_state{};
+    depth_state.depth_test = true;
+    depth_state.depth_write = true;
+    depth_state.depth_func = VK_COMPARE_OP_GREATER_OR_EQUAL;
+    ez_set_depth_state(depth_state);
+
+    ez_bind_vertex_buffer(_renderer->_gpu_scene->position_buffer);
+    ez_bind_index_buffer(index_buffer, VK_INDEX_TYPE_UINT32);
+
+    for (uint32_t i = 0; i < (uint32_t)view_ranges.size(); ++i)
+    {
+        if (view_ranges[i].draw_count == 0)
+            continue;
+
+        ez_set_viewport((float)(i * SHADOW_MAP_SIZE), 0, (float)SHADOW_MAP_SIZE, (float)SHADOW_MAP_SIZE);
+        ez_set_scissor((int32_t)(i * SHADOW_MAP_SIZE), 0, SHADOW_MAP_SIZE, SHADOW_MAP_SIZE);
+        ez_bind_buffer(0, cascade_buffer, sizeof(glm::mat4), i * CASCADE_BUFFER_STRIDE);
+        ez_draw_indexed_indirect(draw_command_buffer, view_ranges[i].first_draw * sizeof(VkDrawIndexedIndirectCommand), view_ranges[i].draw_count,
+                                 sizeof(VkDrawIndexedIndirectCommand));
+    }
+
+    ez_end_rendering();
+}
+
+uint64_t ShadowPass::get_gpu_memory_size() const
+{
+    uint64_t size = (uint64_t)_shadow_texture->width * _shadow_texture->height * 4;
+    for (int i = 0; i < FRAMES_IN_FLIGHT; ++i)
+    {
+        size += _receiver_mask_buffers[i]->size + _cascade_buffers[i]->size;
+    }
+    return size;
+}
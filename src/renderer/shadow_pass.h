@@ -0,0 +1,40 @@
+#pragma once
+#include "renderer.h"
+#include <rhi/ez_vulkan.h>
+
+// Keep in sync with shader_defs.glsl
+#define SHADOW_MAP_SIZE 1024
+#define RECEIVER_MASK_SIZE 32
+
+class RenderGraph;
+
+// Cascaded shadow map of the sun, the cascades side by side in one D32 atlas, reversed-Z like the
+// main depth. Casters are the triangle filtering views: clusters are culled for every cascade in one
+// traversal, then triangles that can only shadow pixels nobody sees are dropped with a light space
+// receiver mask built from this frame's Hi-Z.
+class ShadowPass
+{
+public:
+    ShadowPass(Renderer* renderer);
+
+    ~ShadowPass();
+
+    void setup(RenderGraph* graph);
+
+    uint64_t get_gpu_memory_size() const;
+
+private:
+    void build_receiver_mask();
+
+    void render();
+
+    Renderer* _renderer;
+    EzTexture _shadow_texture = VK_NULL_HANDLE;
+    // Per frame in flight, RECEIVER_MASK_SIZE rows per cascade
+    EzBuffer _receiver_mask_buffers[FRAMES_IN_FLIGHT] = {};
+    // Per frame in flight, one matrix per cascade at a uniform buffer offset alignment
+    EzBuffer _cascade_buffers[FRAMES_IN_FLIGHT] = {};
+    EzSampler _sampler = VK_NULL_HANDLE;
+    EzShader _receiver_mask_shader = VK_NULL_HANDLE;
+    EzShader _vertex_shader = VK_NULL_HANDLE;
+};
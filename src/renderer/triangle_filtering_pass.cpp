@@ -0,0 +1,605 @@
+#include "triangle_filtering_pass.h"
+#include "renderer.h"
+#include "scene.h"
+#include "gpu_scene.h"
+#include "camera.h"
+#include "render_graph.h"
+#include "shader_library.h"
+#include "cpu_profiler.h"
+#include "cpu_triangle_filtering.h"
+#include "frame_fence.h"
+#include <cstring>
+
+// First secondary view in the view matrix buffer, 256 bytes in so the binding offset meets any
+// storage buffer alignment
+#define VIEW_MATRIX_OFFSET 4
+
+TriangleFilteringPass::TriangleFilteringPass(Renderer* renderer)
+{
+    _renderer = renderer;
+
+    _clear_buffers_shader = get_shader("clear_buffers.comp");
+    _triangle_filtering_shaders[0] = get_shader("triangle_filtering_64.comp");
+    _triangle_filtering_shaders[1] = get_shader("triangle_filtering_128.comp");
+    _triangle_filtering_shaders[2] = get_shader("triangle_filtering_256.comp");
+    _receiver_mask_triangle_filtering_shaders[0] = get_shader("triangle_filtering_receiver_mask_64.comp");
+    _receiver_mask_triangle_filtering_shaders[1] = get_shader("triangle_filtering_receiver_mask_128.comp");
+    _receiver_mask_triangle_filtering_shaders[2] = get_shader("triangle_filtering_receiver_mask_256.comp");
+    _batch_compaction_shader = get_shader("batch_compaction.comp");
+    _view_draw_commands_shader = get_shader("view_draw_commands.comp");
+
+    EzBufferDesc buffer_desc{};
+    buffer_desc.size = sizeof(DrawCounter);
+    buffer_desc.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+    buffer_desc.memory_flags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    for (int i = 0; i < FRAMES_IN_FLIGHT; ++i)
+    {
+        ez_create_buffer(buffer_desc, _draw_counter_buffers[i]);
+        ez_create_buffer(buffer_desc, _view_draw_counter_buffers[i]);
+    }
+
+    buffer_desc.size = sizeof(glm::mat4) * (VIEW_MATRIX_OFFSET + MAX_CULLING_VIEWS);
+    for (int i = 0; i < FRAMES_IN_FLIGHT; ++i)
+    {
+        ez_create_buffer(buffer_desc, _view_matrix_buffers[i]);
+    }
+
+    buffer_desc.size = sizeof(UncompactedDrawCommand) * MAX_DRAW_CMD_COUNT;
+    buffer_desc.memory_flags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+    ez_create_buffer(buffer_desc, _view_uncompacted_draw_command_buffer);
+
+    buffer_desc.size = sizeof(VkDrawIndexedIndirectCommand) * MAX_DRAW_CMD_COUNT;
+    buffer_desc.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT;
+    ez_create_buffer(buffer_desc, _view_draw_command_buffer);
+
+    update_output_buffers();
+}
+
+TriangleFilteringPass::~TriangleFilteringPass()
+{
+    for (int i = 0; i < FRAMES_IN_FLIGHT; ++i)
+    {
+        if (_small_batch_buffers[i])
+            ez_destroy_buffer(_small_batch_buffers[i]);
+        ez_destroy_buffer(_draw_counter_buffers[i]);
+        if (_uncompacted_draw_command_buffers[i])
+            ez_destroy_buffer(_uncompacted_draw_command_buffers[i]);
+        if (_draw_command_buffers[i])
+            ez_destroy_buffer(_draw_command_buffers[i]);
+        if (_draw_mesh_buffers[i])
+            ez_destroy_buffer(_draw_mesh_buffers[i]);
+        // Slot 0 belongs to the GpuScene
+        if (i > 0 && _filtered_index_buffers[i])
+            ez_destroy_buffer(_filtered_index_buffers[i]);
+        ez_destroy_buffer(_view_matrix_buffers[i]);
+        ez_destroy_buffer(_view_draw_counter_buffers[i]);
+        if (_view_batch_buffers[i])
+            ez_destroy_buffer(_view_batch_buffers[i]);
+    }
+    if (_view_filtered_index_buffer)
+        ez_destroy_buffer(_view_filtered_index_buffer);
+    ez_destroy_buffer(_view_uncompacted_draw_command_buffer);
+    ez_destroy_buffer(_view_draw_command_buffer);
+    delete _cpu_triangle_filtering;
+    delete _cpu_view_triangle_filtering;
+}
+
+void TriangleFilteringPass::set_cpu_filtering(bool enable)
+{
+    if (enable && !_cpu_triangle_filtering)
+    {
+        _cpu_triangle_filtering = new CpuTriangleFiltering();
+        _cpu_view_triangle_filtering = new CpuTriangleFiltering();
+    }
+    else if (!enable && _cpu_triangle_filtering)
+    {
+        delete _cpu_triangle_filtering;
+        delete _cpu_view_triangle_filtering;
+        _cpu_triangle_filtering = nullptr;
+        _cpu_view_triangle_filtering = nullptr;
+    }
+}
+
+void TriangleFilteringPass::set_views(const std::vector<CullingView>& views)
+{
+    _views = views;
+    if (_views.size() > MAX_CULLING_VIEWS)
+        _views.resize(MAX_CULLING_VIEWS);
+}
+
+void TriangleFilteringPass::set_pipelined(bool enable)
+{
+    _pipelined = enable;
+    _output_slot = 0;
+    update_output_buffers();
+}
+
+void TriangleFilteringPass::update_output_buffers()
+{
+    uint32_t slot_count = _pipelined ? FRAMES_IN_FLIGHT : 1;
+    GpuScene* gpu_scene = _renderer->_gpu_scene;
+    if (gpu_scene)
+        _filtered_index_buffers[0] = gpu_scene->filtered_index_buffer;
+
+    for (uint32_t i = 0; i < FRAMES_IN_FLIGHT; ++i)
+    {
+        if (i < slot_count)
+        {
+            if (!_uncompacted_draw_command_buffers[i])
+            {
+                EzBufferDesc buffer_desc{};
+                buffer_desc.size = sizeof(UncompactedDrawCommand) * MAX_DRAW_CMD_COUNT;
+                buffer_desc.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+                buffer_desc.memory_flags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+                ez_create_buffer(buffer_desc, _uncompacted_draw_command_buffers[i]);
+
+                // Transfer source for the golden image readbacks
+                buffer_desc.size = sizeof(VkDrawIndexedIndirectCommand) * MAX_DRAW_CMD_COUNT;
+                buffer_desc.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+                ez_create_buffer(buffer_desc, _draw_command_buffers[i]);
+
+                buffer_desc.size = sizeof(uint32_t) * MAX_DRAW_CMD_COUNT;
+                buffer_desc.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+                ez_create_buffer(buffer_desc, _draw_mesh_buffers[i]);
+            }
+
+            // Sized like the scene's own filtered index buffer, recreated when the scene changes
+            if (i > 0 && gpu_scene && (!_filtered_index_buffers[i] || _filtered_index_buffers[i]->size != gpu_scene->filtered_index_buffer->size))
+            {
+                if (_filtered_index_buffers[i])
+                    release_buffer(_filtered_index_buffers[i]);
+
+                EzBufferDesc buffer_desc{};
+                buffer_desc.size = gpu_scene->filtered_index_buffer->size;
+                buffer_desc.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+                buffer_desc.memory_flags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+                ez_create_buffer(buffer_desc, _filtered_index_buffers[i]);
+            }
+        }
+        else if (_uncompacted_draw_command_buffers[i])
+        {
+            release_buffer(_uncompacted_draw_command_buffers[i]);
+            release_buffer(_draw_command_buffers[i]);
+            release_buffer(_draw_mesh_buffers[i]);
+            if (_filtered_index_buffers[i])
+                release_buffer(_filtered_index_buffers[i]);
+            _uncompacted_draw_command_buffers[i] = VK_NULL_HANDLE;
+            _draw_command_buffers[i] = VK_NULL_HANDLE;
+            _draw_mesh_buffers[i] = VK_NULL_HANDLE;
+            _filtered_index_buffers[i] = VK_NULL_HANDLE;
+        }
+    }
+}
+
+void TriangleFilteringPass::release_buffer(EzBuffer buffer)
+{
+    _renderer->_graph->release_buffer(buffer);
+    ez_destroy_buffer(buffer);
+}
+
+void TriangleFilteringPass::update_view_buffers()
+{
+    Scene* scene = _renderer->_scene;
+    uint32_t view_count = (uint32_t)_views.size();
+
+    // Worst case every cluster is visible in every view
+    uint32_t cluster_count = 0;
+    for (auto& mesh : scene->meshs)
+    {
+        cluster_count += (uint32_t)mesh.clusters.size();
+    }
+    uint32_t capacity = (cluster_count * view_count + BATCH_COUNT - 1) / BATCH_COUNT * BATCH_COUNT;
+    uint32_t frame_index = _renderer->get_frame_index();
+    if (capacity > _view_batch_capacities[frame_index])
+    {
+        _view_batch_capacities[frame_index] = capacity;
+
+        EzBufferDesc buffer_desc{};
+        buffer_desc.size = sizeof(SmallBatchData) * capacity;
+        buffer_desc.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+        buffer_desc.memory_flags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+        if (_view_batch_buffers[frame_index])
+            release_buffer(_view_batch_buffers[frame_index]);
+        ez_create_buffer(buffer_desc, _view_batch_buffers[frame_index]);
+    }
+
+    uint64_t index_buffer_size = (uint64_t)scene->indices.size() * sizeof(uint32_t) * view_count;
+    if (!_view_filtered_index_buffer || _view_filtered_index_buffer->size != index_buffer_size)
+    {
+        if (_view_filtered_index_buffer)
+            release_buffer(_view_filtered_index_buffer);
+
+        EzBufferDesc buffer_desc{};
+        buffer_desc.size = index_buffer_size;
+        buffer_desc.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+        buffer_desc.memory_flags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+        ez_create_buffer(buffer_desc, _view_filtered_index_buffer);
+    }
+}
+
+void TriangleFilteringPass::write_view_matrix(uint32_t index, const glm::mat4& view_proj_matrix)
+{
+    void* mapped_data = nullptr;
+    EzBuffer view_matrix_buffer = _view_matrix_buffers[_renderer->get_frame_index()];
+    ez_map_memory(view_matrix_buffer, &mapped_data);
+    memcpy((uint8_t*)mapped_data + index * sizeof(glm::mat4), &view_proj_matrix, sizeof(glm::mat4));
+    ez_unmap_memory(view_matrix_buffer);
+}
+
+void TriangleFilteringPass::update_small_batch_buffers()
+{
+    // Worst case is one batch per cluster, rounded up so every chunk starts at an aligned offset
+    uint32_t cluster_count = 0;
+    for (int i = 0; i < _renderer->_scene->meshs.size(); ++i)
+    {
+        cluster_count += (uint32_t)_renderer->_scene->meshs[i].clusters.size();
+    }
+    uint32_t capacity = (cluster_count + BATCH_COUNT - 1) / BATCH_COUNT * BATCH_COUNT;
+    uint32_t frame_index = _renderer->get_frame_index();
+    if (capacity <= _small_batch_capacities[frame_index])
+        return;
+
+    _small_batch_capacities[frame_index] = capacity;
+
+    // The other slots may still be read by frames in flight, they grow on their own frames
+    EzBufferDesc buffer_desc{};
+    buffer_desc.size = sizeof(SmallBatchData) * capacity;
+    buffer_desc.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+    buffer_desc.memory_flags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    if (_small_batch_buffers[frame_index])
+        release_buffer(_small_batch_buffers[frame_index]);
+    ez_create_buffer(buffer_desc, _small_batch_buffers[frame_index]);
+}
+
+void TriangleFilteringPass::read_gpu_counters()
+{
+    // The counter buffer of this frame index was last written FRAMES_IN_FLIGHT frames ago. The frame
+    // fence normally retired that frame already, if it has not the counters are skipped this frame.
+    uint64_t frame_number = _renderer->_frame_number;
+    if (frame_number < FRAMES_IN_FLIGHT)
+        return;
+    if (!_renderer->_frame_fence->is_signaled(_renderer->get_frame_index()))
+        return;
+
+    void* mapped_data = nullptr;
+    EzBuffer draw_counter_buffer = _draw_counter_buffers[_renderer->get_frame_index()];
+    ez_map_memory(draw_counter_buffer, &mapped_data);
+    memcpy(&_gpu_counters, mapped_data, sizeof(DrawCounter));
+    ez_unmap_memory(draw_counter_buffer);
+    _gpu_counters_frame_number = frame_number - FRAMES_IN_FLIGHT;
+}
+
+void TriangleFilteringPass::setup(RenderGraph* graph)
+{
+    GpuScene* gpu_scene = _renderer->_gpu_scene;
+    _output_slot = _pipelined ? _renderer->get_frame_index() : 0;
+    update_output_buffers();
+    if (_cpu_triangle_filtering)
+    {
+        graph->add_pass("cpu_triangle_filtering")
+            .write(_filtered_index_buffers[_output_slot], EZ_RESOURCE_STATE_COPY_DEST)
+            .write(_draw_command_buffers[_output_slot], EZ_RESOURCE_STATE_COPY_DEST)
+            .write(_draw_mesh_buffers[_output_slot], EZ_RESOURCE_STATE_COPY_DEST)
+            .set_execute([this]() { cpu_filter_triangles(); });
+        return;
+    }
+
+    update_small_batch_buffers();
+    read_gpu_counters();
+
+    EzBuffer draw_counter_buffer = _draw_counter_buffers[_renderer->get_frame_index()];
+
+    graph->add_pass("clear_buffers")
+        .write(draw_counter_buffer, EZ_RESOURCE_STATE_UNORDERED_ACCESS)
+        .write(_uncompacted_draw_command_buffers[_output_slot], EZ_RESOURCE_STATE_UNORDERED_ACCESS)
+        .write(_draw_command_buffers[_output_slot], EZ_RESOURCE_STATE_UNORDERED_ACCESS)
+        .set_execute([this]() { clear_buffers(); });
+
+    graph->add_pass("triangle_filtering")
+        .read(gpu_scene->position_buffer, EZ_RESOURCE_STATE_SHADER_RESOURCE)
+        .read(gpu_scene->index_buffer, EZ_RESOURCE_STATE_SHADER_RESOURCE)
+        .read(gpu_scene->mesh_constants_buffer, EZ_RESOURCE_STATE_SHADER_RESOURCE)
+        .write(_filtered_index_buffers[_output_slot], EZ_RESOURCE_STATE_UNORDERED_ACCESS)
+        .write(_uncompacted_draw_command_buffers[_output_slot], EZ_RESOURCE_STATE_UNORDERED_ACCESS)
+        .write(draw_counter_buffer, EZ_RESOURCE_STATE_UNORDERED_ACCESS)
+        .set_execute([this]() { render(); });
+
+    graph->add_pass("batch_compaction")
+        .read(_uncompacted_draw_command_buffers[_output_slot], EZ_RESOURCE_STATE_SHADER_RESOURCE)
+        .write(draw_counter_buffer, EZ_RESOURCE_STATE_UNORDERED_ACCESS)
+        .write(_draw_command_buffers[_output_slot], EZ_RESOURCE_STATE_UNORDERED_ACCESS)
+        .write(_draw_mesh_buffers[_output_slot], EZ_RESOURCE_STATE_UNORDERED_ACCESS)
+        .set_execute([this]() { batch_compaction(); });
+}
+
+void TriangleFilteringPass::setup_views(RenderGraph* graph, EzBuffer receiver_mask_buffer)
+{
+    if (_views.empty())
+        return;
+
+    update_view_buffers();
+    _view_receiver_mask_buffer = receiver_mask_buffer;
+
+    if (_cpu_view_triangle_filtering)
+    {
+        graph->add_pass("cpu_view_triangle_filtering")
+            .write(_view_filtered_index_buffer, EZ_RESOURCE_STATE_COPY_DEST)
+            .write(_view_draw_command_buffer, EZ_RESOURCE_STATE_COPY_DEST)
+            .set_execute([this]() { cpu_filter_views(); });
+        return;
+    }
+
+    GpuScene* gpu_scene = _renderer->_gpu_scene;
+    EzBuffer view_draw_counter_buffer = _view_draw_counter_buffers[_renderer->get_frame_index()];
+
+    graph->add_pass("view_clear_buffers")
+        .write(view_draw_counter_buffer, EZ_RESOURCE_STATE_UNORDERED_ACCESS)
+        .write(_view_uncompacted_draw_command_buffer, EZ_RESOURCE_STATE_UNORDERED_ACCESS)
+        .write(_view_draw_command_buffer, EZ_RESOURCE_STATE_UNORDERED_ACCESS)
+        .set_execute([this]() { clear_view_buffers(); });
+
+    RenderGraphPass& view_triangle_filtering = graph->add_pass("view_triangle_filtering");
+    view_triangle_filtering
+        .read(gpu_scene->position_buffer, EZ_RESOURCE_STATE_SHADER_RESOURCE)
+        .read(gpu_scene->index_buffer, EZ_RESOURCE_STATE_SHADER_RESOURCE)
+        .read(gpu_scene->mesh_constants_buffer, EZ_RESOURCE_STATE_SHADER_RESOURCE)
+        .write(_view_filtered_index_buffer, EZ_RESOURCE_STATE_UNORDERED_ACCESS)
+        .write(_view_uncompacted_draw_command_buffer, EZ_RESOURCE_STATE_UNORDERED_ACCESS)
+        .write(view_draw_counter_buffer, EZ_RESOURCE_STATE_UNORDERED_ACCESS)
+        .set_execute([this]() { render_views(); });
+    if (receiver_mask_buffer)
+        view_triangle_filtering.read(receiver_mask_buffer, EZ_RESOURCE_STATE_SHADER_RESOURCE);
+
+    graph->add_pass("view_draw_commands")
+        .read(_view_uncompacted_draw_command_buffer, EZ_RESOURCE_STATE_SHADER_RESOURCE)
+        .write(_view_draw_command_buffer, EZ_RESOURCE_STATE_UNORDERED_ACCESS)
+        .set_execute([this]() { build_view_draw_commands(); });
+}
+
+void TriangleFilteringPass::clear_buffers()
+{
+    EzBuffer draw_counter_buffer = _draw_counter_buffers[_renderer->get_frame_index()];
+    EzBuffer uncompacted_draw_command_buffer = _uncompacted_draw_command_buffers[_output_slot];
+    EzBuffer draw_command_buffer = _draw_command_buffers[_output_slot];
+
+    ez_reset_pipeline_state();
+
+    ez_bind_buffer(0, draw_counter_buffer, draw_counter_buffer->size);
+    ez_bind_buffer(1, uncompacted_draw_command_buffer, uncompacted_draw_command_buffer->size);
+    ez_bind_buffer(2, draw_command_buffer, draw_command_buffer->size);
+    ez_set_compute_shader(_clear_buffers_shader);
+    ez_dispatch(std::max(1u, (uint32_t)(MAX_DRAW_CMD_COUNT) / 256), 1, 1);
+}
+
+void TriangleFilteringPass::render()
+{
+    {
+        PROFILE_SCOPE("cluster_culling");
+        cull_clusters(_renderer->_scene, _renderer->_camera->get_translation(), _culling_result);
+        _stats = _culling_result.stats;
+        _draw_count = std::min(_culling_result.draw_count, (uint32_t)MAX_DRAW_CMD_COUNT);
+    }
+
+    if (_culling_result.batches.empty())
+        return;
+
+    // Every chunk reads its own range of this frame's batch buffer
+    void* mapped_data = nullptr;
+    EzBuffer small_batch_buffer = _small_batch_buffers[_renderer->get_frame_index()];
+    ez_map_memory(small_batch_buffer, &mapped_data);
+    memcpy(mapped_data, _culling_result.batches.data(), _culling_result.batches.size() * sizeof(SmallBatchData));
+    ez_unmap_memory(small_batch_buffer);
+    write_view_matrix(0, _renderer->_view_proj_matrix);
+
+    ez_reset_pipeline_state();
+
+    EzBuffer draw_counter_buffer = _draw_counter_buffers[_renderer->get_frame_index()];
+    for (uint32_t chunk = 0; chunk < _culling_result.get_chunk_count(); ++chunk)
+    {
+        filter_triangles(small_batch_buffer, chunk, _culling_result.get_chunk_batch_count(chunk), _filtered_index_buffers[_output_slot],
+                         _uncompacted_draw_command_buffers[_output_slot], draw_counter_buffer, 0, VK_NULL_HANDLE);
+    }
+}
+
+void TriangleFilteringPass::clear_view_buffers()
+{
+    EzBuffer view_draw_counter_buffer = _view_draw_counter_buffers[_renderer->get_frame_index()];
+
+    ez_reset_pipeline_state();
+
+    ez_bind_buffer(0, view_draw_counter_buffer, view_draw_counter_buffer->size);
+    ez_bind_buffer(1, _view_uncompacted_draw_command_buffer, _view_uncompacted_draw_command_buffer->size);
+    ez_bind_buffer(2, _view_draw_command_buffer, _view_draw_command_buffer->size);
+    ez_set_compute_shader(_clear_buffers_shader);
+    ez_dispatch(std::max(1u, (uint32_t)(MAX_DRAW_CMD_COUNT) / 256), 1, 1);
+}
+
+void TriangleFilteringPass::render_views()
+{
+    {
+        PROFILE_SCOPE("multi_view_cluster_culling");
+        cull_clusters_multi_view(_renderer->_scene, _views, _view_culling_result);
+    }
+
+    if (_view_culling_result.batches.empty())
+        return;
+
+    void* mapped_data = nullptr;
+    EzBuffer view_batch_buffer = _view_batch_buffers[_renderer->get_frame_index()];
+    ez_map_memory(view_batch_buffer, &mapped_data);
+    memcpy(mapped_data, _view_culling_result.batches.data(), _view_culling_result.batches.size() * sizeof(SmallBatchData));
+    ez_unmap_memory(view_batch_buffer);
+    for (uint32_t i = 0; i < _views.size(); ++i)
+    {
+        write_view_matrix(VIEW_MATRIX_OFFSET + i, _views[i].view_proj_matrix);
+    }
+
+    ez_reset_pipeline_state();
+
+    EzBuffer view_draw_counter_buffer = _view_draw_counter_buffers[_renderer->get_frame_index()];
+    for (uint32_t chunk = 0; chunk < _view_culling_result.get_chunk_count(); ++chunk)
+    {
+        filter_triangles(view_batch_buffer, chunk, _view_culling_result.get_chunk_batch_count(chunk), _view_filtered_index_buffer,
+                         _view_uncompacted_draw_command_buffer, view_draw_counter_buffer, VIEW_MATRIX_OFFSET, _view_receiver_mask_buffer);
+    }
+}
+
+void TriangleFilteringPass::build_view_draw_commands()
+{
+    ez_reset_pipeline_state();
+
+    ez_bind_buffer(0, _view_uncompacted_draw_command_buffer, _view_uncompacted_draw_command_buffer->size);
+    ez_bind_buffer(1, _view_draw_command_buffer, _view_draw_command_buffer->size);
+    ez_set_compute_shader(_view_draw_commands_shader);
+    ez_dispatch(std::max(1u, (uint32_t)(MAX_DRAW_CMD_COUNT) / 256), 1, 1);
+}
+
+void TriangleFilteringPass::cpu_filter_views()
+{
+    Scene* scene = _renderer->_scene;
+    cull_clusters_multi_view(scene, _views, _view_culling_result);
+
+    std::vector<glm::mat4> view_proj_matrices;
+    for (auto& view : _views)
+    {
+        view_proj_matrices.push_back(view.view_proj_matrix);
+    }
+    _cpu_view_triangle_filtering->filter(scene, view_proj_matrices, _view_culling_result);
+
+    // The ranges of the views are packed one after the other
+    const ViewCullingRange& last_range = _view_culling_result.views.back();
+    uint32_t index_count = last_range.first_index + last_range.index_count;
+    if (index_count > 0)
+        ez_update_buffer(_view_filtered_index_buffer, index_count * sizeof(uint32_t), 0, (void*)_cpu_view_triangle_filtering->get_filtered_indices().data());
+
+    // Same in order layout as view_draw_commands.comp, empty draws included
+    const std::vector<UncompactedDrawCommand>& uncompacted_draw_commands = _cpu_view_triangle_filtering->get_uncompacted_draw_commands();
+    std::vector<DrawCommand> draw_commands(MAX_DRAW_CMD_COUNT);
+    for (uint32_t i = 0; i < MAX_DRAW_CMD_COUNT; ++i)
+    {
+        draw_commands[i].index_count = uncompacted_draw_commands[i].num_indices;
+        draw_commands[i].instance_count = 1;
+        draw_commands[i].first_index = uncompacted_draw_commands[i].start_index;
+        draw_commands[i].vertex_offset = 0;
+        draw_commands[i].first_instance = 0;
+    }
+    ez_update_buffer(_view_draw_command_buffer, (uint32_t)(draw_commands.size() * sizeof(VkDrawIndexedIndirectCommand)), 0, (void*)draw_commands.data());
+}
+
+void TriangleFilteringPass::cpu_filter_triangles()
+{
+    Scene* scene = _renderer->_scene;
+    cull_clusters(scene, _renderer->_camera->get_translation(), _culling_result);
+    _stats = _culling_result.stats;
+
+    _cpu_triangle_filtering->filter(scene, _renderer->_view_proj_matrix, _culling_result);
+    _gpu_counters = _cpu_triangle_filtering->get_counters();
+    _gpu_counters_frame_number = _renderer->_frame_number;
+
+    // Output ranges are packed by the visible triangle count, anything past it is never drawn
+    uint32_t index_count = _stats.visible_triangle_count * 3;
+    if (index_count > 0)
+        ez_update_buffer(_filtered_index_buffers[_output_slot], index_count * sizeof(uint32_t), 0, (void*)_cpu_triangle_filtering->get_filtered_indices().data());
+
+    // Only the compacted draws are uploaded, so only those are drawn
+    const std::vector<DrawCommand>& draw_commands = _cpu_triangle_filtering->get_draw_commands();
+    _draw_count = (uint32_t)draw_commands.size();
+    if (!draw_commands.empty())
+    {
+        ez_update_buffer(_draw_command_buffers[_output_slot], (uint32_t)(draw_commands.size() * sizeof(VkDrawIndexedIndirectCommand)), 0, (void*)draw_commands.data());
+        ez_update_buffer(_draw_mesh_buffers[_output_slot], _draw_count * sizeof(uint32_t), 0, (void*)_cpu_triangle_filtering->get_draw_mesh_indices().data());
+    }
+}
+
+void TriangleFilteringPass::batch_compaction()
+{
+    EzBuffer draw_counter_buffer = _draw_counter_buffers[_renderer->get_frame_index()];
+    EzBuffer uncompacted_draw_command_buffer = _uncompacted_draw_command_buffers[_output_slot];
+    EzBuffer draw_command_buffer = _draw_command_buffers[_output_slot];
+    EzBuffer draw_mesh_buffer = _draw_mesh_buffers[_output_slot];
+
+    ez_reset_pipeline_state();
+
+    ez_bind_buffer(0, draw_counter_buffer, draw_counter_buffer->size);
+    ez_bind_buffer(1, uncompacted_draw_command_buffer, uncompacted_draw_command_buffer->size);
+    ez_bind_buffer(2, draw_command_buffer, draw_command_buffer->size);
+    ez_bind_buffer(3, draw_mesh_buffer, draw_mesh_buffer->size);
+    ez_set_compute_shader(_batch_compaction_shader);
+    ez_dispatch(std::max(1u, (uint32_t)(MAX_DRAW_CMD_COUNT) / 256), 1, 1);
+}
+
+void TriangleFilteringPass::filter_triangles(EzBuffer batch_buffer, uint32_t chunk, uint32_t chunk_batch_count, EzBuffer filtered_index_buffer,
+                                             EzBuffer uncompacted_draw_command_buffer, EzBuffer draw_counter_buffer, uint32_t view_matrix_offset,
+                                             EzBuffer receiver_mask_buffer)
+{
+    PROFILE_SCOPE("filter_triangles");
+
+    uint32_t chunk_offset = chunk * BATCH_COUNT * sizeof(SmallBatchData);
+    uint32_t chunk_size = chunk_batch_count * sizeof(SmallBatchData);
+
+    ez_bind_buffer(0, _renderer->_gpu_scene->position_buffer, _renderer->_gpu_scene->position_buffer->size);
+    ez_bind_buffer(1, _renderer->_gpu_scene->index_buffer, _renderer->_gpu_scene->index_buffer->size);
+    ez_bind_buffer(2, _renderer->_gpu_scene->mesh_constants_buffer, _renderer->_gpu_scene->mesh_constants_buffer->size);
+    ez_bind_buffer(3, batch_buffer, chunk_size, chunk_offset);
+    ez_bind_buffer(4, filtered_index_buffer, filtered_index_buffer->size);
+    ez_bind_buffer(5, uncompacted_draw_command_buffer, uncompacted_draw_command_buffer->size);
+    // Batches pick their matrix with view_index, relative to the bound range
+    EzBuffer view_matrix_buffer = _view_matrix_buffers[_renderer->get_frame_index()];
+    uint32_t view_matrix_range = view_matrix_offset * sizeof(glm::mat4);
+    ez_bind_buffer(6, view_matrix_buffer, view_matrix_buffer->size - view_matrix_range, view_matrix_range);
+    ez_bind_buffer(7, draw_counter_buffer, draw_counter_buffer->size);
+    // The work group size has to match the cluster size the scene was cooked with
+    uint32_t cluster_size = _renderer->_scene->cluster_size;
+    uint32_t shader_index = cluster_size == 64 ? 0 : cluster_size == 128 ? 1 : 2;
+    if (receiver_mask_buffer)
+    {
+        ez_bind_buffer(8, receiver_mask_buffer, receiver_mask_buffer->size);
+        ez_set_compute_shader(_receiver_mask_triangle_filtering_shaders[shader_index]);
+    }
+    else
+    {
+        ez_set_compute_shader(_triangle_filtering_shaders[shader_index]);
+    }
+    ez_dispatch(chunk_batch_count, 1, 1);
+}
+
+uint64_t TriangleFilteringPass::get_gpu_memory_size() const
+{
+    uint64_t size = 0;
+    for (int i = 0; i < FRAMES_IN_FLIGHT; ++i)
+    {
+        if (_uncompacted_draw_command_buffers[i])
+            size += _uncompacted_draw_command_buffers[i]->size + _draw_command_buffers[i]->size + _draw_mesh_buffers[i]->size;
+        if (i > 0 && _filtered_index_buffers[i])
+            size += _filtered_index_buffers[i]->size;
+        if (_small_batch_buffers[i])
+            size += _small_batch_buffers[i]->size;
+        if (_view_batch_buffers[i])
+            size += _view_batch_buffers[i]->size;
+        size += _draw_counter_buffers[i]->size + _view_draw_counter_buffers[i]->size + _view_matrix_buffers[i]->size;
+    }
+    size += _view_uncompacted_draw_command_buffer->size + _view_draw_command_buffer->size;
+    if (_view_filtered_index_buffer)
+        size += _view_filtered_index_buffer->size;
+    return size;
+}
+
+EzBuffer TriangleFilteringPass::get_index_buffer()
+{
+    return _filtered_index_buffers[_output_slot];
+}
+
+uint32_t TriangleFilteringPass::get_draw_count()
+{
+    return _draw_count;
+}
+
+EzBuffer TriangleFilteringPass::get_draw_command_buffer()
+{
+    return _draw_command_buffers[_output_slot];
+}
+
+EzBuffer TriangleFilteringPass::get_draw_mesh_buffer()
+{
+    return _draw_mesh_buffers[_output_slot];
+}
\ No newline at end of file
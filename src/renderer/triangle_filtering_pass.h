@@ -0,0 +1,143 @@
+#pragma once
+
+#include "renderer.h"
+#include "cluster_culling.h"
+#include <rhi/ez_vulkan.h>
+#include <vector>
+
+class RenderGraph;
+class CpuTriangleFiltering;
+
+class TriangleFilteringPass
+{
+public:
+    TriangleFilteringPass(Renderer* renderer);
+
+    ~TriangleFilteringPass();
+
+    void setup(RenderGraph* graph);
+
+    // Filters on the host and uploads the results, for devices without the required compute features
+    void set_cpu_filtering(bool enable);
+
+    // One set of output buffers per frame in flight instead of a single shared one. Nothing in a
+    // frame's filtering then waits on the previous frame still drawing and shading from its outputs.
+    void set_pipelined(bool enable);
+
+    // Secondary views such as shadow cascades, culled together in one cluster traversal and filtered
+    // into their own index buffer and in order indirect draws. The passes are culled while nothing
+    // reads get_view_index_buffer() or get_view_draw_command_buffer().
+    void set_views(const std::vector<CullingView>& views);
+
+    // Added by the pass consuming the views, after the passes its receiver mask depends on. With a
+    // receiver mask, RECEIVER_MASK_SIZE rows per view, triangles covering no marked light space cell
+    // are removed. The CPU filtering path ignores the mask.
+    void setup_views(RenderGraph* graph, EzBuffer receiver_mask_buffer = VK_NULL_HANDLE);
+
+    EzBuffer get_view_index_buffer() const { return _view_filtered_index_buffer; }
+
+    EzBuffer get_view_draw_command_buffer() const { return _view_draw_command_buffer; }
+
+    // Draws and index range of every view, valid once the filtering passes have executed
+    const std::vector<ViewCullingRange>& get_view_ranges() const { return _view_culling_result.views; }
+
+    // Views left empty because the draws of all views did not fit in MAX_DRAW_CMD_COUNT
+    uint32_t get_dropped_view_count() const { return _view_culling_result.dropped_view_count; }
+
+    // Visible clusters of the main view left out because their draws did not fit
+    uint32_t get_dropped_cluster_count() const { return _culling_result.dropped_cluster_count; }
+
+    EzBuffer get_index_buffer();
+
+    // Draws to issue from get_draw_command_buffer(). On the GPU path the compacted count is only known
+    // on the device, this is an upper bound and the draws past the compacted ones are empty.
+    uint32_t get_draw_count();
+
+    EzBuffer get_draw_command_buffer();
+
+    // One mesh index per compacted draw
+    EzBuffer get_draw_mesh_buffer();
+
+    const TriangleFilteringStats& get_stats() const { return _stats; }
+
+    // Counters written by the shaders of frame get_gpu_counters_frame_number()
+    const DrawCounter& get_gpu_counters() const { return _gpu_counters; }
+
+    uint64_t get_gpu_counters_frame_number() const { return _gpu_counters_frame_number; }
+
+    uint64_t get_gpu_memory_size() const;
+
+private:
+    // Destroys a buffer replaced at runtime, along with the state the render graph tracked for it
+    void release_buffer(EzBuffer buffer);
+
+    void update_small_batch_buffers();
+
+    void update_output_buffers();
+
+    void update_view_buffers();
+
+    void write_view_matrix(uint32_t index, const glm::mat4& view_proj_matrix);
+
+    void read_gpu_counters();
+
+    void clear_buffers();
+
+    void render();
+
+    void filter_triangles(EzBuffer batch_buffer, uint32_t chunk, uint32_t chunk_batch_count, EzBuffer filtered_index_buffer,
+                          EzBuffer uncompacted_draw_command_buffer, EzBuffer draw_counter_buffer, uint32_t view_matrix_offset,
+                          EzBuffer receiver_mask_buffer);
+
+    void batch_compaction();
+
+    void cpu_filter_triangles();
+
+    void clear_view_buffers();
+
+    void render_views();
+
+    void build_view_draw_commands();
+
+    void cpu_filter_views();
+
+private:
+    Renderer* _renderer;
+    uint32_t _draw_count = 0;
+    TriangleFilteringStats _stats{};
+    DrawCounter _gpu_counters{};
+    uint64_t _gpu_counters_frame_number = 0;
+    ClusterCullingResult _culling_result;
+    CpuTriangleFiltering* _cpu_triangle_filtering = nullptr;
+    // Per frame in flight, sized to hold every batch of a frame. A slot only grows on its own frame,
+    // once the frame fence has retired its previous use.
+    uint32_t _small_batch_capacities[FRAMES_IN_FLIGHT] = {};
+    EzBuffer _small_batch_buffers[FRAMES_IN_FLIGHT] = {};
+    EzBuffer _draw_counter_buffers[FRAMES_IN_FLIGHT] = {};
+    // Outputs, slot 0 filters into the scene's filtered index buffer, the other slots only
+    // exist while pipelined. The slot of the last filtered frame is the one drawn and shaded.
+    bool _pipelined = false;
+    uint32_t _output_slot = 0;
+    EzBuffer _filtered_index_buffers[FRAMES_IN_FLIGHT] = {};
+    EzBuffer _uncompacted_draw_command_buffers[FRAMES_IN_FLIGHT] = {};
+    EzBuffer _draw_command_buffers[FRAMES_IN_FLIGHT] = {};
+    EzBuffer _draw_mesh_buffers[FRAMES_IN_FLIGHT] = {};
+    // Per frame in flight, the main view matrix followed by the secondary views at VIEW_MATRIX_OFFSET
+    EzBuffer _view_matrix_buffers[FRAMES_IN_FLIGHT] = {};
+    std::vector<CullingView> _views;
+    MultiViewCullingResult _view_culling_result;
+    CpuTriangleFiltering* _cpu_view_triangle_filtering = nullptr;
+    uint32_t _view_batch_capacities[FRAMES_IN_FLIGHT] = {};
+    EzBuffer _view_batch_buffers[FRAMES_IN_FLIGHT] = {};
+    EzBuffer _view_draw_counter_buffers[FRAMES_IN_FLIGHT] = {};
+    EzBuffer _view_filtered_index_buffer = VK_NULL_HANDLE;
+    EzBuffer _view_uncompacted_draw_command_buffer = VK_NULL_HANDLE;
+    EzBuffer _view_draw_command_buffer = VK_NULL_HANDLE;
+    EzBuffer _view_receiver_mask_buffer = VK_NULL_HANDLE;
+    EzShader _clear_buffers_shader = VK_NULL_HANDLE;
+    // One variant per supported cluster size: 64, 128, 256
+    EzShader _triangle_filtering_shaders[3] = {};
+    EzShader _receiver_mask_triangle_filtering_shaders[3] = {};
+    EzShader _batch_compaction_shader = VK_NULL_HANDLE;
+    EzShader _view_draw_commands_shader = VK_NULL_HANDLE;
+};
\ No newline at end of file
@@ -0,0 +1,136 @@
+#include "visibility_bufer_shading_pass.h"
+#include "rsg.h"
+#include "scene.h"
+#include "gpu_scene.h"
+#include "renderer.h"
+#include "triangle_filtering_pass.h"
+#include "light_culling_pass.h"
+#include "material_binning_pass.h"
+#include "render_graph.h"
+#include "shader_library.h"
+
+VisibilityBufferShadingPass::VisibilityBufferShadingPass(Renderer* renderer)
+{
+    _renderer = renderer;
+
+    EzSamplerDesc sampler_desc{};
+    sampler_desc.address_u = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    sampler_desc.address_v = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    sampler_desc.address_w = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    ez_create_sampler(sampler_desc, _sampler);
+
+    _vertex_shader = get_shader("visibility_buffer_shading_tiles.vert");
+    _fragment_shader = get_shader("visibility_buffer_shading_pass.frag");
+    _shadows_fragment_shader = get_shader("visibility_buffer_shading_pass_shadows.frag");
+}
+
+VisibilityBufferShadingPass::~VisibilityBufferShadingPass()
+{
+    ez_destroy_sampler(_sampler);
+}
+
+void VisibilityBufferShadingPass::setup(RenderGraph* graph)
+{
+    GpuScene* gpu_scene = _renderer->_gpu_scene;
+    MaterialBinningPass* material_binning_pass = _renderer->_material_binning_pass;
+
+    RenderGraphPass& shading_pass = graph->add_pass("visibility_buffer_shading");
+    shading_pass
+        .read(_renderer->_vb_rt, EZ_RESOURCE_STATE_SHADER_RESOURCE)
+        .read(gpu_scene->position_buffer, EZ_RESOURCE_STATE_SHADER_RESOURCE)
+        .read(gpu_scene->normal_buffer, EZ_RESOURCE_STATE_SHADER_RESOURCE)
+        .read(gpu_scene->uv_buffer, EZ_RESOURCE_STATE_SHADER_RESOURCE)
+        .read(_renderer->_triangle_filtering_pass->get_index_buffer(), EZ_RESOURCE_STATE_SHADER_RESOURCE)
+        .read(_renderer->_triangle_filtering_pass->get_draw_command_buffer(), EZ_RESOURCE_STATE_SHADER_RESOURCE)
+        .read(gpu_scene->light_buffer, EZ_RESOURCE_STATE_SHADER_RESOURCE)
+        .read(_renderer->_light_culling_pass->get_light_grid_buffer(), EZ_RESOURCE_STATE_SHADER_RESOURCE)
+        .read(_renderer->_light_culling_pass->get_light_index_buffer(), EZ_RESOURCE_STATE_SHADER_RESOURCE)
+        .read(gpu_scene->material_buffer, EZ_RESOURCE_STATE_SHADER_RESOURCE)
+        .read(material_binning_pass->get_material_tile_buffer(), EZ_RESOURCE_STATE_SHADER_RESOURCE)
+        .read(material_binning_pass->get_draw_command_buffer(), EZ_RESOURCE_STATE_INDIRECT_ARGUMENT)
+        // Only depth tested, declared with the attachment state the material depth pass left it in since no read-only depth state is used in this renderer
+        .read(_renderer->_material_depth_rt, EZ_RESOURCE_STATE_DEPTH_WRITE)
+        .write(_renderer->_output_rt, EZ_RESOURCE_STATE_RENDERTARGET)
+        .set_pipeline_statistics()
+        .set_execute([this]() { render(); });
+    if (_renderer->_shadows)
+        shading_pass.read(_renderer->_shadow_rt, EZ_RESOURCE_STATE_SHADER_RESOURCE);
+}
+
+void VisibilityBufferShadingPass::render()
+{
+    RenderGraph* graph = _renderer->_graph;
+    EzTexture vb_rt = graph->get_texture(_renderer->_vb_rt);
+
+    ez_reset_pipeline_state();
+
+    EzRenderingAttachmentInfo color_info{};
+    graph->get_attachment(_renderer->_output_rt, color_info);
+    // The sky, no material draw covers it
+    color_info.clear_value.color = {1.0f, 1.0f, 1.0f, 0.0f};
+
+    EzRenderingAttachmentInfo depth_info{};
+    depth_info.texture = graph->get_texture(_renderer->_material_depth_rt);
+    depth_info.load_op = VK_ATTACHMENT_LOAD_OP_LOAD;
+
+    EzRenderingInfo rendering_info{};
+    rendering_info.width = _renderer->_width;
+    rendering_info.height = _renderer->_height;
+    rendering_info.colors.push_back(color_info);
+    rendering_info.depth.push_back(depth_info);
+    ez_begin_rendering(rendering_info);
+
+    ez_set_viewport(0, 0, (float)_renderer->_width, (float)_renderer->_height);
+    ez_set_scissor(0, 0, (int32_t)_renderer->_width, (int32_t)_renderer->_height);
+
+    ez_set_vertex_shader(_vertex_shader);
+    ez_set_fragment_shader(_renderer->_shadows ? _shadows_fragment_shader : _fragment_shader);
+
+    ez_set_vertex_binding(0, 20);
+    ez_set_vertex_attrib(0, 0, VK_FORMAT_R32G32B32_SFLOAT, 0);
+    ez_set_vertex_attrib(0, 1, VK_FORMAT_R32G32_SFLOAT, 12);
+
+    // Only the pixels of the drawn material, rejected before the fragment shader runs
+    EzDepthState depth_state{};
+    depth_state.depth_test = true;
+    depth_state.depth_write = false;
+    depth_state.depth_func = VK_COMPARE_OP_EQUAL;
+    ez_set_depth_state(depth_state);
+
+    EzBuffer draw_command_buffer = _renderer->_triangle_filtering_pass->get_draw_command_buffer();
+    EzBuffer view_buffer = _renderer->get_view_buffer();
+    ez_bind_texture(0, vb_rt, 0);
+    ez_bind_sampler(1, _sampler);
+    ez_bind_buffer(2, _renderer->_gpu_scene->position_buffer, _renderer->_gpu_scene->position_buffer->size);
+    ez_bind_buffer(3, _renderer->_gpu_scene->normal_buffer, _renderer->_gpu_scene->normal_buffer->size);
+    ez_bind_buffer(4, _renderer->_gpu_scene->uv_buffer, _renderer->_gpu_scene->uv_buffer->size);
+    EzBuffer filtered_index_buffer = _renderer->_triangle_filtering_pass->get_index_buffer();
+    ez_bind_buffer(5, filtered_index_buffer, filtered_index_buffer->size);
+    ez_bind_buffer(6, draw_command_buffer, draw_command_buffer->size);
+    ez_bind_buffer(7, view_buffer, view_buffer->size);
+    if (_renderer->_shadows)
+        ez_bind_texture(8, graph->get_texture(_renderer->_shadow_rt), 0);
+    EzBuffer light_buffer = _renderer->_gpu_scene->light_buffer;
+    EzBuffer light_grid_buffer = _renderer->_light_culling_pass->get_light_grid_buffer();
+    EzBuffer light_index_buffer = _renderer->_light_culling_pass->get_light_index_buffer();
+    ez_bind_buffer(9, light_buffer, light_buffer->size);
+    ez_bind_buffer(10, light_grid_buffer, light_grid_buffer->size);
+    ez_bind_buffer(11, light_index_buffer, light_index_buffer->size);
+    EzBuffer material_tile_buffer = _renderer->_material_binning_pass->get_material_tile_buffer();
+    ez_bind_buffer(13, material_tile_buffer, material_tile_buffer->size);
+
+    ez_set_primitive_topology(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST);
+    ez_bind_vertex_buffer(RSG::quad_buffer);
+    ez_bind_index_buffer(RSG::quad_index_buffer, VK_INDEX_TYPE_UINT32);
+
+    // One draw per material over the tiles it covers, materials absent from the view draw no instance
+    EzBuffer material_buffer = _renderer->_gpu_scene->material_buffer;
+    EzBuffer material_draw_command_buffer = _renderer->_material_binning_pass->get_draw_command_buffer();
+    for (uint32_t i = 0; i < _renderer->_gpu_scene->material_count; ++i)
+    {
+        ez_bind_buffer(12, material_buffer, sizeof(MaterialConstants), i * MATERIAL_BUFFER_STRIDE);
+        ez_draw_indexed_indirect(material_draw_command_buffer, i * sizeof(VkDrawIndexedIndirectCommand), 1, sizeof(VkDrawIndexedIndirectCommand));
+    }
+
+    ez_end_rendering();
+}
\ No newline at end of file
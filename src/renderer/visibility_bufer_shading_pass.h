@@ -2,6 +2,7 @@
 #include <rhi/ez_vulkan.h>
 
 class Renderer;
+class RenderGraph;
 
 class VisibilityBufferShadingPass
 {
@@ -10,9 +11,14 @@ public:
 
     ~VisibilityBufferShadingPass();
 
-    void render();
+    void setup(RenderGraph* graph);
 
 private:
+    void render();
+
     Renderer* _renderer;
     EzSampler _sampler = VK_NULL_HANDLE;
+    EzShader _vertex_shader = VK_NULL_HANDLE;
+    EzShader _fragment_shader = VK_NULL_HANDLE;
+    EzShader _shadows_fragment_shader = VK_NULL_HANDLE;
 };
\ No newline at end of file
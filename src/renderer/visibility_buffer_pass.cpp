@@ -0,0 +1,88 @@
+#include "visibility_buffer_pass.h"
+#include "triangle_filtering_pass.h"
+#include "renderer.h"
+#include "scene.h"
+#include "gpu_scene.h"
+#include "render_graph.h"
+#include "shader_library.h"
+
+VisibilityBufferPass::VisibilityBufferPass(Renderer* renderer)
+{
+    _renderer = renderer;
+    _vertex_shader = get_shader("visibility_buffer_pass.vert");
+    _fragment_shader = get_shader("visibility_buffer_pass.frag");
+}
+
+VisibilityBufferPass::~VisibilityBufferPass()
+{
+
+}
+
+void VisibilityBufferPass::setup(RenderGraph* graph)
+{
+    EzBuffer index_buffer = _renderer->_triangle_filtering_pass->get_index_buffer();
+    EzBuffer draw_command_buffer = _renderer->_triangle_filtering_pass->get_draw_command_buffer();
+
+    graph->add_pass("visibility_buffer")
+        .read(_renderer->_gpu_scene->position_buffer, EZ_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER)
+        .read(index_buffer, EZ_RESOURCE_STATE_INDEX_BUFFER)
+        .read(draw_command_buffer, EZ_RESOURCE_STATE_INDIRECT_ARGUMENT)
+        .write(_renderer->_vb_rt, EZ_RESOURCE_STATE_RENDERTARGET)
+        .write(_renderer->_depth_rt, EZ_RESOURCE_STATE_DEPTH_WRITE)
+        .set_pipeline_statistics()
+        .set_execute([this]() { render(); });
+}
+
+void VisibilityBufferPass::render()
+{
+    EzBuffer vertex_buffer = _renderer->_gpu_scene->position_buffer;
+    EzBuffer index_buffer = _renderer->_triangle_filtering_pass->get_index_buffer();
+    // The compacted draws, draw_id is an index into the same list the shading passes read
+    EzBuffer draw_command_buffer = _renderer->_triangle_filtering_pass->get_draw_command_buffer();
+    uint32_t draw_count = _renderer->_triangle_filtering_pass->get_draw_count();
+    EzBuffer view_buffer = _renderer->get_view_buffer();
+    RenderGraph* graph = _renderer->_graph;
+
+    ez_reset_pipeline_state();
+
+    EzRenderingAttachmentInfo color_info{};
+    color_info.texture = graph->get_texture(_renderer->_vb_rt);
+    color_info.clear_value.color = {1.0f, 1.0f, 1.0f, 1.0f};
+
+    EzRenderingAttachmentInfo depth_info{};
+    depth_info.texture = graph->get_texture(_renderer->_depth_rt);
+    // Reversed-Z, 0 is infinitely far
+    depth_info.clear_value.depthStencil = {0.0f, 0};
+
+    EzRenderingInfo rendering_info{};
+    rendering_info.width = _renderer->_width;
+    rendering_info.height = _renderer->_height;
+    rendering_info.colors.push_back(color_info);
+    rendering_info.depth.push_back(depth_info);
+    ez_begin_rendering(rendering_info);
+
+    ez_set_viewport(0, 0, (float)_renderer->_width, (float)_renderer->_height);
+    ez_set_scissor(0, 0, (int32_t)_renderer->_width, (int32_t)_renderer->_height);
+
+    ez_set_vertex_shader(_vertex_shader);
+    ez_set_fragment_shader(_fragment_shader);
+
+    ez_bind_buffer(0, view_buffer, view_buffer->size);
+
+    ez_set_vertex_binding(0, 12);
+    ez_set_vertex_attrib(0, 0, VK_FORMAT_R32G32B32_SFLOAT, 0);
+
+    ez_set_primitive_topology(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST);
+
+    EzDepthState depth_state{};
+    depth_state.depth_test = true;
+    depth_state.depth_write = true;
+    depth_state.depth_func = VK_COMPARE_OP_GREATER_OR_EQUAL;
+    ez_set_depth_state(depth_state);
+
+    ez_bind_vertex_buffer(vertex_buffer);
+    ez_bind_index_buffer(index_buffer, VK_INDEX_TYPE_UINT32);
+    ez_draw_indexed_indirect(draw_command_buffer, 0, draw_count, sizeof(VkDrawIndexedIndirectCommand));
+
+    ez_end_rendering();
+}
\ No newline at end of file
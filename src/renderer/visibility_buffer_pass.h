@@ -1,6 +1,8 @@
 #pragma once
+#include <rhi/ez_vulkan.h>
 
 class Renderer;
+class RenderGraph;
 
 class VisibilityBufferPass
 {
@@ -9,8 +11,12 @@ public:
 
     ~VisibilityBufferPass();
 
-    void render();
+    void setup(RenderGraph* graph);
 
 private:
+    void render();
+
     Renderer* _renderer;
+    EzShader _vertex_shader = VK_NULL_HANDLE;
+    EzShader _fragment_shader = VK_NULL_HANDLE;
 };
\ No newline at end of file
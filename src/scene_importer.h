@@ -1,7 +0,0 @@
-#pragma once
-
-#include <string>
-
-class Scene;
-
-Scene* load_scene(const std::string& file_path);
\ No newline at end of file
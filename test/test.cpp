@@ -0,0 +1,207 @@
+#include "scene.h"
+#include "scene_importer.h"
+#include "camera.h"
+#include "camera_path.h"
+#include "cluster_culling.h"
+#include "cpu_triangle_filtering.h"
+#include "renderer.h"
+#include "golden.h"
+#include <core/path.h>
+#include <rhi/ez_vulkan.h>
+#include <rhi/rhi_shader_mgr.h>
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+// Returned when there are no golden images to compare against, CTest reports the test as skipped
+#define TEST_SKIPPED 77
+
+struct TestOptions
+{
+    std::string scene = "scene://dragon/dragon.gltf";
+    std::string golden_directory;
+    bool update_golden = false;
+    uint32_t width = 640;
+    uint32_t height = 360;
+    uint32_t view_count = 4;
+    // Triangles on a clip plane may go either way between the shader and the host
+    double max_filtering_mismatch_ratio = 0.0005;
+};
+
+static TestOptions parse_options(int argc, char** argv)
+{
+    TestOptions options;
+    for (int i = 1; i < argc; ++i)
+    {
+        bool has_value = i + 1 < argc;
+        if (strcmp(argv[i], "--scene") == 0 && has_value)
+            options.scene = argv[++i];
+        else if (strcmp(argv[i], "--golden") == 0 && has_value)
+            options.golden_directory = argv[++i];
+        else if (strcmp(argv[i], "--update-golden") == 0)
+            options.update_golden = true;
+        else if (strcmp(argv[i], "--width") == 0 && has_value)
+            options.width = (uint32_t)atoi(argv[++i]);
+        else if (strcmp(argv[i], "--height") == 0 && has_value)
+            options.height = (uint32_t)atoi(argv[++i]);
+        else if (strcmp(argv[i], "--views") == 0 && has_value)
+            options.view_count = (uint32_t)atoi(argv[++i]);
+    }
+    return options;
+}
+
+// Mesh and index triple of every filtered triangle, sorted since neither path keeps a fixed draw order
+static std::vector<std::array<uint32_t, 4>> get_filtered_triangles(const std::vector<uint32_t>& indices, const std::vector<DrawCommand>& draw_commands,
+                                                                   const std::vector<uint32_t>& draw_mesh_indices)
+{
+    std::vector<std::array<uint32_t, 4>> triangles;
+    for (size_t i = 0; i < draw_commands.size() && i < draw_mesh_indices.size(); ++i)
+    {
+        const DrawCommand& draw_command = draw_commands[i];
+        for (uint32_t j = 0; j + 2 < draw_command.index_count && draw_command.first_index + j + 2 < indices.size(); j += 3)
+        {
+            const uint32_t* triangle = &indices[draw_command.first_index + j];
+            triangles.push_back({draw_mesh_indices[i], triangle[0], triangle[1], triangle[2]});
+        }
+    }
+    std::sort(triangles.begin(), triangles.end());
+    return triangles;
+}
+
+// GPU filtering of every view against CpuTriangleFiltering with the same culling, the triangles only
+// present on one side count as mismatches
+static bool test_filtering(const TestOptions& options, Scene* scene, Camera* camera, const CameraPath& camera_path, Renderer* renderer, EzTexture target)
+{
+    bool passed = true;
+    CpuTriangleFiltering triangle_filtering;
+    ClusterCullingResult culling_result;
+    for (uint32_t view = 0; view < options.view_count; ++view)
+    {
+        camera_path.apply(camera, (float)view / (float)options.view_count);
+        renderer->render(target);
+        ez_submit();
+
+        std::vector<uint32_t> indices;
+        std::vector<DrawCommand> draw_commands;
+        std::vector<uint32_t> draw_mesh_indices;
+        renderer->read_filtered_draws(indices, draw_commands, draw_mesh_indices);
+        std::vector<std::array<uint32_t, 4>> gpu_triangles = get_filtered_triangles(indices, draw_commands, draw_mesh_indices);
+
+        cull_clusters(scene, camera->get_translation(), culling_result);
+        triangle_filtering.filter(scene, camera->get_proj_matrix() * camera->get_view_matrix(), culling_result);
+        std::vector<std::array<uint32_t, 4>> cpu_triangles = get_filtered_triangles(triangle_filtering.get_filtered_indices(), triangle_filtering.get_draw_commands(),
+                                                                                  triangle_filtering.get_draw_mesh_indices());
+
+        std::vector<std::array<uint32_t, 4>> mismatches;
+        std::set_symmetric_difference(gpu_triangles.begin(), gpu_triangles.end(), cpu_triangles.begin(), cpu_triangles.end(), std::back_inserter(mismatches));
+        size_t triangle_count = std::max(gpu_triangles.size(), cpu_triangles.size());
+        bool view_passed = (double)mismatches.size() <= options.max_filtering_mismatch_ratio * (double)std::max((size_t)1, triangle_count);
+        std::cout << "filtering view " << view << ": gpu " << gpu_triangles.size() << ", cpu " << cpu_triangles.size()
+                  << ", mismatches " << mismatches.size() << (view_passed ? "" : " FAILED") << std::endl;
+        passed = passed && view_passed;
+    }
+    return passed;
+}
+
+// "scene://dragon/dragon.gltf" -> "dragon", the name the benchmark writes its goldens with
+static std::string get_scene_name(const std::string& scene_path)
+{
+    size_t begin = scene_path.find_last_of("/\\");
+    begin = begin == std::string::npos ? 0 : begin + 1;
+    size_t end = scene_path.find_last_of('.');
+    end = end == std::string::npos || end < begin ? scene_path.size() : end;
+    return scene_path.substr(begin, end - begin);
+}
+
+// GPU and CPU paths against the same golden images
+static int test_golden(const TestOptions& options, Scene* scene, Camera* camera, const CameraPath& camera_path, Renderer* renderer)
+{
+    GoldenOptions golden_options;
+    golden_options.directory = options.golden_directory;
+    golden_options.update = options.update_golden;
+    golden_options.view_count = options.view_count;
+    std::string scene_name = get_scene_name(options.scene);
+
+    bool passed = true;
+    bool missing = false;
+    for (bool cpu : {false, true})
+    {
+        golden_options.cpu = cpu;
+        GoldenResult result = run_golden(golden_options, scene_name, scene, camera, camera_path, renderer, options.width, options.height);
+        std::cout << (cpu ? "golden cpu: " : "golden gpu: ");
+        write_golden_result(std::cout, result);
+        std::cout << std::endl;
+        passed = passed && result.passed;
+        for (auto& image : result.images)
+        {
+            missing = missing || image.missing;
+        }
+        // The CPU path only writes ids, the GPU path has written them already
+        if (options.update_golden)
+            break;
+    }
+
+    if (missing)
+    {
+        std::cout << "golden images missing in " << options.golden_directory << ", create them with --update-golden" << std::endl;
+        return TEST_SKIPPED;
+    }
+    return passed ? 0 : 1;
+}
+
+int main(int argc, char** argv)
+{
+    TestOptions options = parse_options(argc, argv);
+
+    Path::register_protocol("content", std::string(PROJECT_DIR) + "/content/");
+    Path::register_protocol("scene", std::string(PROJECT_DIR) + "/content/scene/");
+    Path::register_protocol("shader", std::string(PROJECT_DIR) + "/content/shader/");
+
+    ez_init();
+    rhi_shader_mgr_init();
+
+    int exit_code = 0;
+    Scene* scene = load_scene(options.scene);
+    if (!scene)
+    {
+        std::cerr << "failed to load " << options.scene << std::endl;
+        exit_code = 1;
+    }
+    else
+    {
+        Camera* camera = new Camera();
+        camera->set_aspect((float)options.width / (float)options.height);
+        CameraPath camera_path = CameraPath::create_orbit(scene->bounds, 64);
+
+        Renderer* renderer = new Renderer();
+        renderer->set_scene(scene);
+        renderer->set_camera(camera);
+        // Every view has to run the filtering passes
+        renderer->set_temporal_reuse(false);
+        EzTexture target = Renderer::create_offscreen_target(options.width, options.height);
+
+        if (options.golden_directory.empty())
+        {
+            exit_code = test_filtering(options, scene, camera, camera_path, renderer, target) ? 0 : 1;
+        }
+        else
+        {
+            exit_code = test_golden(options, scene, camera, camera_path, renderer);
+        }
+
+        ez_flush();
+        ez_destroy_texture(target);
+        delete renderer;
+        delete camera;
+        delete scene;
+    }
+
+    rhi_shader_mgr_terminate();
+    ez_flush();
+    ez_terminate();
+    return exit_code;
+}